@@ -0,0 +1,116 @@
+/*
+ * modbus_cache.c
+ *
+ *  Created on: 16 ott 2026
+ *      Author: fabizani
+ */
+
+#include <Core/modbus_cache.h>
+#include <stdlib.h>
+
+/**************************************************************************************************
+ * 										TYPE DEFINITION
+ **************************************************************************************************/
+
+struct sMODBUS_Cache {
+	sCacheEntry *entries;
+	uint16_t u16Mask;			///< Numero di posti - 1 (potenza di 2)
+};
+
+/**************************************************************************************************
+ *									DICHIARAZIONI PRIVATE
+ **************************************************************************************************/
+static uint32_t CacheKey(uint8_t slaveID, uint8_t table, uint16_t address);
+static uint16_t CacheHash(const hMODBUS_Cache cache, uint32_t key);
+
+/**************************************************************************************************
+ * 										FUNZIONI PRIVATE
+ **************************************************************************************************/
+
+// La tabella è un Function Code di lettura, mai 0: nessuna chiave valida vale 0
+static uint32_t CacheKey(uint8_t slaveID, uint8_t table, uint16_t address) {
+	return ((uint32_t) slaveID << 24) | ((uint32_t) table << 16) | address;
+}
+
+// Hash moltiplicativo: indirizzi consecutivi finiscono in posti lontani tra loro
+static uint16_t CacheHash(const hMODBUS_Cache cache, uint32_t key) {
+	return ((key * 2654435761u) >> 16) & cache->u16Mask;
+}
+
+/**************************************************************************************************
+ * 										METODI DELL'ADT
+ **************************************************************************************************/
+hMODBUS_Cache CacheNew(uint16_t size) {
+	uint32_t slots = CACHE_PROBES;
+
+	while (slots < size && slots < CACHE_MAX_SIZE)
+		slots <<= 1;
+
+	hMODBUS_Cache cache = malloc(sizeof(struct sMODBUS_Cache));
+	if (cache == NULL)
+		return NULL;
+
+	cache->entries = calloc(slots, sizeof(sCacheEntry));
+	if (cache->entries == NULL) {
+		free(cache);
+		return NULL;
+	}
+	cache->u16Mask = slots - 1;
+
+	return cache;
+}
+
+void CacheDelete(hMODBUS_Cache cache) {
+	free(cache->entries);
+	free(cache);
+}
+
+void CacheStore(hMODBUS_Cache cache, uint8_t slaveID, uint8_t table, uint16_t address,
+		uint16_t value, uint32_t now) {
+	uint32_t key = CacheKey(slaveID, table, address);
+	uint16_t index = CacheHash(cache, key);
+	sCacheEntry *victim = NULL;
+
+	for (uint8_t i = 0; i < CACHE_PROBES; i++) {
+		sCacheEntry *entry = &cache->entries[(index + i) & cache->u16Mask];
+
+		if (entry->u32Key == key || entry->u32Key == 0) {
+			victim = entry;
+			break;
+		}
+
+		// Tutti occupati: sostituiamo il valore letto meno di recente
+		if (victim == NULL || (int32_t) (entry->u32Timestamp - victim->u32Timestamp) < 0)
+			victim = entry;
+	}
+
+	victim->u32Key = key;
+	victim->u32Timestamp = now;
+	victim->u16Value = value;
+	victim->u8Error = 0;
+}
+
+void CacheSetError(hMODBUS_Cache cache, uint8_t slaveID, uint8_t table, uint16_t address,
+		uint8_t error) {
+	sCacheEntry *entry = (sCacheEntry*) CacheFind(cache, slaveID, table, address);
+
+	if (entry != NULL)
+		entry->u8Error = error;
+}
+
+const sCacheEntry* CacheFind(const hMODBUS_Cache cache, uint8_t slaveID, uint8_t table,
+		uint16_t address) {
+	uint32_t key = CacheKey(slaveID, table, address);
+	uint16_t index = CacheHash(cache, key);
+
+	for (uint8_t i = 0; i < CACHE_PROBES; i++) {
+		const sCacheEntry *entry = &cache->entries[(index + i) & cache->u16Mask];
+
+		if (entry->u32Key == key)
+			return entry;
+		if (entry->u32Key == 0)
+			return NULL;
+	}
+
+	return NULL;
+}
@@ -0,0 +1,60 @@
+/*
+ * modbus_cache.h
+ *
+ *  Created on: 16 ott 2026
+ *      Author: fabizani
+ *
+ *  Cache dei valori letti dal Master, indicizzata per (slave, tabella, indirizzo). La tabella è
+ *  indicata dal Function Code di lettura (1 coils, 2 discretes, 3 holdings, 4 inputs).
+ *  Uso interno della libreria: l'applicazione la legge con MODBUS_CacheGet / MODBUS_CacheLookup.
+ *
+ *  Hash table a indirizzamento aperto, allocata una volta sola: la ricerca guarda al più
+ *  CACHE_PROBES posti consecutivi. Se sono tutti occupati, il nuovo valore prende il posto di
+ *  quello letto meno di recente.
+ */
+
+#ifndef CORE_MODBUS_CACHE_H_
+#define CORE_MODBUS_CACHE_H_
+
+#include <stdint.h>
+
+/**************************************************************************************************
+ * 									  OPTIONS FROM DEFINE
+ **************************************************************************************************/
+#define CACHE_PROBES		8		///< Posti esaminati per ogni chiave
+#define CACHE_MAX_SIZE		32768
+
+/**************************************************************************************************
+ * 										TYPE DECLARATION
+ **************************************************************************************************/
+// Dichiarazione dell'ADT
+typedef struct sMODBUS_Cache* hMODBUS_Cache;
+
+/// Valore in cache
+typedef struct {
+	uint32_t u32Key;			///< Slave, tabella e indirizzo; 0 se il posto è libero
+	uint32_t u32Timestamp;		///< Istante (ms) dell'ultima lettura andata a buon fine
+	uint16_t u16Value;			///< Ultimo valore letto
+	uint8_t u8Error;			///< Esito dell'ultima interrogazione (eMODBUS_Excpt), 0 se corretta
+} sCacheEntry;
+
+/**************************************************************************************************
+ * 										METODI DELL'ADT
+ **************************************************************************************************/
+// creates a cache of at least size entries (rounded up to a power of 2), NULL if out of memory
+hMODBUS_Cache CacheNew(uint16_t size);
+void CacheDelete(hMODBUS_Cache cache);
+
+// stores a value read at time now, clearing the error state
+void CacheStore(hMODBUS_Cache cache, uint8_t slaveID, uint8_t table, uint16_t address,
+		uint16_t value, uint32_t now);
+
+// records a failed read of an address already in cache (unknown addresses are ignored)
+void CacheSetError(hMODBUS_Cache cache, uint8_t slaveID, uint8_t table, uint16_t address,
+		uint8_t error);
+
+// returns the entry of the address, NULL if it was never read
+const sCacheEntry* CacheFind(const hMODBUS_Cache cache, uint8_t slaveID, uint8_t table,
+		uint16_t address);
+
+#endif /* CORE_MODBUS_CACHE_H_ */
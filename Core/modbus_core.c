@@ -14,6 +14,8 @@
  */
 
 #include <Core/modbus_core.h>
+#include <Core/modbus_cache.h>
+#include <Core/modbus_crc.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -37,17 +39,42 @@ if(event != 0) \
  * Quando viene effettuata una ricezione in modalità Slave, abbiamo 1.5 volte il tempo di word per
  * ricere la successiva parola (11 bits/word * 1.5).
  * In modalità Master abbiamo 3.5 volte il tempo di word per ricevere la risposta dallo Slave.
+ * Sopra i 19200 baud la specifica fissa invece i tempi a 750us e 1750us, che in tempi-bit
+ * crescono con il baudrate.
  */
 #define SLAVE_BITS_TIMEOUT				17
 #define MASTER_BITS_TIMEOUT				38
+#define FIXED_TIMING_BAUDRATE			19200
+#define SLAVE_FIXED_TIMEOUT_us			750
+#define MASTER_FIXED_TIMEOUT_us			1750
 #define MODBUS_FRAME_MAX_SIZE			260
 #define MASTER_HEADER_BYTES				6
 #define SLAVE_HEADER_BYTES				3
 #define MASTER_FRAME_LENGTH				8
-#define SLAVE_FRAME_LENGTH				6
-
-#define QUEUED_COMMANDS					16
+#define SLAVE_FRAME_LENGTH				5	///< La risposta più corta è un'eccezione: 3 byte + CRC
+
+#define MAX_READ_REGISTERS				125
+#define MAX_READ_BITS					2000
+#define MAX_WRITE_REGISTERS				123
+#define MAX_WRITE_BITS					1968
+#define MAX_RW_WRITE_REGISTERS			121	///< FC23: registri scritti al massimo
+#define RW_HEADER_BYTES					10	///< FC23: byte della richiesta prima del ByteCount
+#define MASK_WRITE_BYTES				8	///< FC22: richiesta e risposta, CRC escluso
+
+#define QUEUED_COMMANDS					16	///< Comandi accodati per ogni livello di priorità
+/// Comandi più urgenti spediti di fila mentre un livello meno urgente attende: poi tocca a lui
+#define PRIORITY_STARVATION_LIMIT		8
+#define MERGED_READS					QUEUED_COMMANDS	///< Letture unite al massimo in una richiesta
+
+/// Allineamento dei buffer delle frame nell'handle, per poterli passare direttamente al DMA.
+/// I dati grezzi sono il primo campo della frame, quindi ereditano l'allineamento della struct.
+#ifndef MODBUS_FRAME_ALIGN
+#define MODBUS_FRAME_ALIGN				4
+#endif
 #define RX_TIMEOUT_ms					250
+#define TURNAROUND_DELAY_ms				100	///< Attesa dopo un broadcast, per l'esecuzione negli slave
+#define RTT_DEVIATION_GAIN				4	///< Timeout adattativo: media + GAIN * deviazione
+#define RTT_MAX_CEILING_ms				8000	///< Le stime (x8) devono stare in 16 bit
 
 /**************************************************************************************************
  * 										TYPE DEFINITION
@@ -61,6 +88,19 @@ typedef union {
 	uint8_t u8[4];		///< "Spacchettata" della word in quattro u8
 } bytesFields;
 
+/// Stima del tempo di risposta di uno slave, in millisecondi a virgola fissa (come il RTO del TCP)
+typedef struct {
+	uint16_t u16Srtt8;		///< Media mobile del tempo di risposta, x8
+	uint16_t u16RttVar4;	///< Deviazione media, x4
+	uint8_t u8Valid;		///< Lo slave ha risposto almeno una volta
+} sSlaveTiming;
+
+/// Stato di uno slave per il backoff del Master
+typedef struct {
+	sMODBUS_SlaveHealth status;	///< Contatori e stato visibili all'applicazione
+	uint32_t u32NextProbe;		///< Istante dal quale lo slave in backoff può ricevere una sonda
+} sSlaveHealth;
+
 /// Enum per la gestione degli stati di ricezione del Master
 typedef enum {
 	Rx_NOP,
@@ -78,7 +118,6 @@ typedef enum {
  * è necessario solo in questo contesto.
  */
 typedef struct {
-	uint16_t u16Length;	///< Lunghezza totale del pacchetto. Gestita dai metodi del MODBUS
 	union {
 		uint8_t raw[MODBUS_FRAME_MAX_SIZE];	///< Dati grezzi per semplificare la spedizione UART
 		struct {
@@ -108,10 +147,10 @@ typedef struct {
 			};
 		};
 	};
+	uint16_t u16Length;	///< Lunghezza totale del pacchetto. Gestita dai metodi del MODBUS
 } sMaster_Frame;
 
 typedef struct {
-	uint16_t u16Length;	///< Lunghezza totale del pacchetto. Gestita dai metodi del MODBUS
 	union {
 		uint8_t raw[MODBUS_FRAME_MAX_SIZE];	///< Dati grezzi per semplificare la ricezione UART
 		struct {
@@ -120,6 +159,7 @@ typedef struct {
 			uint8_t u8ByteCount;	///< Byte totali dei dati ricevuti
 		};
 	};
+	uint16_t u16Length;	///< Lunghezza totale del pacchetto. Gestita dai metodi del MODBUS
 } sSlave_Frame;
 
 /// Definizione dell'interfaccia per le funzioni di aggiunta dati alla frame Slave
@@ -128,6 +168,20 @@ typedef void (*AppendToFrame)(sSlave_Frame*, bytesFields);
 /// Definizione dell'interfaccia per le funzioni di decodifica del payload dalla frame Slave
 typedef uint16_t (*readPayload)(sSlave_Frame*, uint16_t);
 
+/**
+ * Banco di memoria contiguo gestito direttamente dalla libreria. Se la richiesta del Master cade
+ * interamente nel banco, i dati sono copiati senza passare dalle funzioni utente.
+ */
+typedef struct {
+	union {
+		uint16_t *pu16Regs;	///< Registri, nell'endianess della macchina
+		uint8_t *pu8Bits;	///< Coils/discretes impacchettati, LSB = primo indirizzo
+	};
+	uint16_t u16Base;		///< Indirizzo MODBUS del primo elemento del banco
+	uint16_t u16Size;		///< Numero di elementi (registri o bit) del banco
+	uint8_t u8IsBits;		///< Il banco contiene bit e non registri
+} sRegBank;
+
 /** Struttura che serve da interfaccia per tutti metodi interni di lettura/scrittura dei vari tipi
  * di dato del MODBUS. sRegister memorizza i puntatori a funzione che vengono poi utilizzati per
  * modificare il comportamento in base al tipo di dato richiesto (Strategy design pattern).
@@ -135,7 +189,15 @@ typedef uint16_t (*readPayload)(sSlave_Frame*, uint16_t);
 typedef struct {
 	MODBUS_LocalRead reading;	///< Funzione utente di lettura dei dati
 	MODBUS_LocalWrite writing;	///< Funzione utente di scrittura dei dati
+	MODBUS_LocalReadRegs readingRegs;	///< Funzione utente di lettura a blocchi (registri)
+	MODBUS_LocalReadBits readingBits;	///< Funzione utente di lettura a blocchi (coils/discretes)
+	MODBUS_LocalWriteRegs writingRegs;	///< Funzione utente di scrittura a blocchi (registri)
+	MODBUS_LocalWriteBits writingBits;	///< Funzione utente di scrittura a blocchi (coils)
+	MODBUS_LocalMaskWrite writingMask;	///< Funzione utente di scrittura con maschera (FC22)
 	MODBUS_RemoteData remote;	///< Evento di ricezioni dati remoti (Master Mode)
+	MODBUS_RemoteRegs remoteRegs;	///< Evento di ricezione a blocchi (registri, Master Mode)
+	MODBUS_RemoteBits remoteBits;	///< Evento di ricezione a blocchi (coils/discretes, Master Mode)
+	sRegBank bank;				///< Eventuale banco di memoria gestito dalla libreria
 
 	AppendToFrame appendData;	///< Funzione di libreria che genera la frame slave di risposta
 	readPayload readPayload;	///< Funzione di libreria che decodifica i dati dalla frame slave
@@ -159,16 +221,61 @@ typedef void (*ExecuteTask)(MODBUS_t*);
  * i metodi in modalità rientrante.
  */
 struct sMODBUS {
-	UART_HandleTypeDef *pxCom;		///< Handle di una porta UART della HAL di STMCube
+	const sMODBUS_Port *pxPort;		///< Driver della porta seriale (NULL: nessun hardware)
 	uint8_t *u8myAddress;	///< L'indirizzo del protocollo MODBUS
 	eMODBUS_Mode uxMode;	///< Modalità MODBUS: Master o Slave
 
-	Queue_t commands;			///< Coda per salvare i comandi ricevuti
+	Queue_t commands[MODBUS_PRIORITY_LEVELS];	///< Code dei comandi, una per priorità
+	uint8_t au8Skipped[MODBUS_PRIORITY_LEVELS];	///< Comandi più urgenti passati davanti al livello
+	uint8_t u8CmdLevel;			///< Coda di provenienza di lastCmd, MODBUS_PRIORITY_LEVELS se polling
 	sMODBUS_Commmand lastCmd;	///< Ultimo comando estratto dalla coda in modalità Master
+	sMODBUS_Commmand mergedReads[MERGED_READS];	///< Letture unite in lastCmd, da consegnare
+	uint8_t u8MergedReads;		///< Letture unite in lastCmd, 0 se lastCmd non è un'unione
+	uint8_t u8MergeEnabled;		///< Unione delle letture vicine abilitata
+	uint16_t u16MergeGap;		///< Massimo numero di indirizzi non richiesti tra due letture unite
+	uint8_t u8WriteCombine;		///< Unione delle scritture singole abilitata
+	union {
+		uint16_t au16Regs[MAX_WRITE_REGISTERS];
+		uint8_t au8Bits[(MAX_WRITE_BITS + 7) / 8];
+	} combinedWrite;			///< Valori delle scritture singole unite in lastCmd
+	/// Appoggio per le callback a blocchi: registri decodificati o bitmap riallineata.
+	/// Come le frame sta nell'handle, così il task non occupa centinaia di byte di stack
+	union {
+		uint16_t au16Regs[MAX_READ_REGISTERS];
+		uint8_t au8Bits[(MAX_READ_BITS + 7) / 8];
+	} blockScratch;
+	MODBUS_RawResponse rawDone;	///< Transazione raw in corso: callback da chiamare al termine
+	sMODBUS_PollEntry *pxPollTable;	///< Tabella di polling periodico (MODBUS_SetPollTable)
+	uint16_t u16PollEntries;	///< Voci della tabella di polling
+	uint32_t u32PollMissed;		///< Periodi saltati da tutte le voci di polling
+	volatile uint32_t u32TickMs;	///< Millisecondi contati da MODBUS_MasterTickRxTimer/AdvanceTime
+	hMODBUS_Cache pxCache;		///< Cache dei valori remoti, NULL se disabilitata
+	uint16_t u16CacheTtlMs;		///< Età sotto la quale una voce di polling non viene spedita
+	void *rawContext;			///< Contesto della transazione raw in corso
+	MODBUS_InFlight inFlight;	///< Comandi in volo del trasporto esterno, NULL se assente
+	void *inFlightContext;		///< Contesto di inFlight
+	uint8_t u8InFlightSlots;	///< Slot consultati con inFlight
+	sSlaveTiming *pxTiming;		///< Tempi di risposta per ogni slave, NULL se timeout fisso
+	uint16_t u16TimeoutFloorMs;	///< Timeout adattativo minimo
+	uint16_t u16TimeoutCeilingMs;	///< Timeout adattativo massimo, e iniziale
+	sSlaveHealth *pxHealth;		///< Stato di ogni slave, NULL se il backoff è disattivato
+	uint8_t u8MaxFailures;		///< Errori consecutivi che mandano uno slave in backoff
+	uint16_t u16BackoffMinMs;	///< Primo intervallo tra le sonde
+	uint16_t u16BackoffMaxMs;	///< Intervallo massimo tra le sonde
+	uint16_t u16TurnaroundMs;	///< Attesa dopo una richiesta broadcast
 
 	uint8_t u8RxComplete;	///< Flag di ricezione completata
+	uint8_t u8TxAsync;		///< La trasmissione termina con MODBUS_SetTxComplete (es. DMA)
+	volatile uint8_t u8TxBusy;	///< Trasmissione asincrona in corso: i buffer TX sono occupati
 	uint16_t u16RxTimeout;	///< Timeout di ricezione: se scade, torna ad accodare comandi
+	uint16_t u16RxTimeoutSet;	///< Timeout impostato alla spedizione, per misurare la risposta
 	hRingBuffer pxRxBuff;	///< Puntatore al Ring Buffer che salva i dati ricevuti
+	volatile uint16_t u16RxCRC;	///< CRC calcolato in ricezione (MODBUS_STREAMING_CRC)
+
+	/// Frame del Master: ricevuta in modalità Slave, trasmessa in modalità Master
+	sMaster_Frame mFrame __attribute__((aligned(MODBUS_FRAME_ALIGN)));
+	/// Frame dello Slave: trasmessa in modalità Slave, ricevuta in modalità Master
+	sSlave_Frame sFrame __attribute__((aligned(MODBUS_FRAME_ALIGN)));
 
 	sRegister coils;		///< Interfaccia per le funzioni dei registri Coils
 	sRegister discretes;	///< Interfaccia per le funzioni dei registri Discretes
@@ -192,30 +299,99 @@ struct sMODBUS {
  *************************************************************************************************/
 eMODBUS_Excpt ReadMasterFrame(MODBUS_t *const handle, sMaster_Frame *mFrame);
 eMODBUS_Excpt ReadSlaveFrame(MODBUS_t *const handle, sSlave_Frame *sFrame);
-sSlave_Frame setupExceptionFrame(const sMaster_Frame *mFrame, eMODBUS_Excpt excpt);
-
-// Funzioni per l'elaborazione della risposta
-sSlave_Frame ReadValues(MODBUS_t *handle, const sMaster_Frame *mFrame);
-sSlave_Frame WriteSingle(MODBUS_t *handle, const sMaster_Frame *mFrame);
-sSlave_Frame WriteMultipleCoils(MODBUS_t *handle, const sMaster_Frame *mFrame);
-sSlave_Frame WriteMultipleRegisters(MODBUS_t *handle, const sMaster_Frame *mFrame);
+uint16_t FetchRxFrame(MODBUS_t *handle, uint8_t *raw, uint16_t *rxCRC);
+void DiscardRx(MODBUS_t *handle);
+void RxLock(const MODBUS_t *handle);
+void RxUnlock(const MODBUS_t *handle);
+uint16_t MasterFrameLength(const sMaster_Frame *mFrame);
+uint16_t SlaveFrameLength(const sSlave_Frame *sFrame);
+eMODBUS_Excpt ReadRawFrame(MODBUS_t *handle, sSlave_Frame *sFrame);
+void FinishRawTransaction(MODBUS_t *handle, eMODBUS_Excpt error, const uint8_t *response,
+		uint16_t length);
+eMODBUS_Excpt DeliverResponse(MODBUS_t *handle, const sMODBUS_Commmand *cmd, sSlave_Frame *sFrame,
+		uint16_t firstAddress);
+uint8_t IsSameRead(const sMODBUS_Commmand *cmd, const sMODBUS_Commmand *other);
+uint8_t IsReadInFlight(const MODBUS_t *handle, const sMODBUS_Commmand *cmd);
+uint8_t QueuedReadLevel(const MODBUS_t *handle, const sMODBUS_Commmand *cmd);
+void DropQueuedRead(MODBUS_t *handle, uint8_t level, const sMODBUS_Commmand *cmd);
+uint8_t CommandPop(MODBUS_t *handle, sMODBUS_Commmand *cmd);
+uint8_t PollSchedule(MODBUS_t *handle, sMODBUS_Commmand *cmd);
+void CacheMarkError(MODBUS_t *handle, const sMODBUS_Commmand *cmd, eMODBUS_Excpt error);
+uint8_t CacheIsFresh(const MODBUS_t *handle, const sMODBUS_Commmand *cmd);
+uint8_t PollIsDue(const MODBUS_t *handle, const sMODBUS_PollEntry *entry);
+void PollConsume(MODBUS_t *handle, sMODBUS_PollEntry *entry);
+uint8_t MergeRead(const MODBUS_t *handle, sMODBUS_Commmand *merged, const sMODBUS_Commmand *cmd);
+void CoalesceReads(MODBUS_t *handle);
+void CombineWrites(MODBUS_t *handle);
+uint8_t IsWriteFunction(uint8_t funcCode);
+uint8_t IsValidCommand(const sMODBUS_Commmand *cmd);
+uint16_t RequestField(const sMODBUS_Commmand *cmd);
+eMODBUS_Excpt CheckResponse(const sMODBUS_Commmand *cmd, const sSlave_Frame *sFrame);
+void CacheStoreWrite(MODBUS_t *handle, const sMODBUS_Commmand *cmd);
+uint16_t SilenceBits(const MODBUS_t *handle, uint16_t bits, uint32_t fixedUs);
+uint16_t ResponseTimeout(const MODBUS_t *handle, uint8_t slaveID);
+void ResponseTimeoutStart(MODBUS_t *handle, uint8_t slaveID);
+void ResponseTimeSample(MODBUS_t *handle, uint8_t slaveID);
+void ResponseTimeLost(MODBUS_t *handle, uint8_t slaveID);
+uint8_t SlaveMayTransmit(MODBUS_t *handle, uint8_t slaveID);
+void SlaveAnswered(MODBUS_t *handle, uint8_t slaveID);
+void SlaveFailed(MODBUS_t *handle, uint8_t slaveID, uint8_t timeout);
+eMODBUS_Excpt CheckFrameCRC(const uint8_t *raw, uint16_t len, uint16_t rxLength, uint16_t rxCRC);
+void setupExceptionFrame(const sMaster_Frame *mFrame, sSlave_Frame *sFrame, eMODBUS_Excpt excpt);
+
+// Funzioni per l'elaborazione della risposta. Costruiscono la risposta direttamente nella sFrame
+// passata (quella dell'handle), senza CRC; in caso di errore ritornano l'eccezione da spedire.
+eMODBUS_Excpt ExecuteRequest(MODBUS_t *handle, const sMaster_Frame *mFrame, sSlave_Frame *sFrame);
+eMODBUS_Excpt ReadValues(MODBUS_t *handle, const sMaster_Frame *mFrame, sSlave_Frame *sFrame);
+eMODBUS_Excpt WriteSingle(MODBUS_t *handle, const sMaster_Frame *mFrame, sSlave_Frame *sFrame);
+eMODBUS_Excpt WriteMultipleCoils(MODBUS_t *handle, const sMaster_Frame *mFrame,
+		sSlave_Frame *sFrame);
+eMODBUS_Excpt WriteMultipleRegisters(MODBUS_t *handle, const sMaster_Frame *mFrame,
+		sSlave_Frame *sFrame);
+eMODBUS_Excpt ReadWriteRegisters(MODBUS_t *handle, const sMaster_Frame *mFrame,
+		sSlave_Frame *sFrame);
+eMODBUS_Excpt MaskWriteRegister(MODBUS_t *handle, const sMaster_Frame *mFrame,
+		sSlave_Frame *sFrame);
+void FrameSlave_EchoRequest(const sMaster_Frame *mFrame, sSlave_Frame *sFrame);
+void WriteCoils_PerAddress(MODBUS_t *handle, const sMaster_Frame *mFrame, uint16_t AddressOffset,
+		uint16_t u16EndAdd);
+eMODBUS_Excpt WriteRegisterBlock(MODBUS_t *handle, uint16_t AddressOffset, uint16_t writeLength,
+		const uint8_t *payload);
+eMODBUS_Excpt WriteRegisters_PerAddress(MODBUS_t *handle, const uint8_t *payload,
+		uint16_t AddressOffset, uint16_t u16EndAdd);
 
 void FrameSlave_AppendCoil(sSlave_Frame *sFrame, bytesFields data);
 void FrameSlave_AppendRegister(sSlave_Frame *sFrame, bytesFields data);
+eMODBUS_Excpt FrameSlave_AppendRegisterBlock(sSlave_Frame *sFrame, MODBUS_LocalReadRegs readFn,
+		uint16_t address, uint16_t length, uint16_t *values);
+eMODBUS_Excpt FrameSlave_AppendCoilBlock(sSlave_Frame *sFrame, MODBUS_LocalReadBits readFn,
+		uint16_t address, uint16_t length);
+
+sMODBUS_ReadResult Register_ReadOne(const sRegister *reg, uint16_t address);
+eMODBUS_Excpt Register_WriteOne(const sRegister *reg, uint16_t address, uint16_t value);
+
+uint8_t Bank_Contains(const sRegBank *bank, uint16_t address, uint16_t length);
+void Bank_ReadToFrame(const sRegBank *bank, sSlave_Frame *sFrame, uint16_t address,
+		uint16_t length);
+void Bitmap_Extract(uint8_t *dest, const uint8_t *src, uint16_t srcBit, uint16_t count);
+void Bitmap_Insert(uint8_t *dest, uint16_t destBit, const uint8_t *src, uint16_t count);
 
 uint16_t FrameSlave_ReadCoils(sSlave_Frame *sFrame, uint16_t address);
 uint16_t FrameSlave_ReadRegisters(sSlave_Frame *sFrame, uint16_t address);
 
 void FrameSlave_AppendCRC(sSlave_Frame *sFrame);
 void FrameMaster_AppendCRC(sMaster_Frame *mFrame);
-
-uint16_t calcCRC(const uint8_t *Buffer, uint8_t u8length);
+void FrameMaster_FromCommand(const sMODBUS_Commmand *cmd, sMaster_Frame *mFrame);
 
 // Implementazione dummy per le funzioni di read/write esterne. Usando queste funzioni vuote
 // possiamo eseguire lo stesso l'applicazione senza avere dei segfault e ritornare delle eccezioni.
 sMODBUS_ReadResult dummyReadingFunction(const uint16_t address);
 eMODBUS_Excpt dummyWritingFunction(const uint16_t address, const uint16_t data);
 void dummyTxData(const MODBUS_t *handle, const uint8_t *data, const uint8_t len);
+void portTxData(const MODBUS_t *handle, const uint8_t *data, const uint8_t len);
+
+void FreeHandle(MODBUS_t *handle);
+void StartTx(MODBUS_t *handle, const uint8_t *data, uint16_t length);
 
 // TASK DI ELABORAZIONE DELLA STACK MODBUS
 void MODBUS_SlaveTask(MODBUS_t *handle);
@@ -225,21 +401,89 @@ void MODBUS_SlaveTask(MODBUS_t *handle);
 // funzioni di stato. Sarà la funzione stessa a cambiare il puntatore verso il nuovo stato.
 void MODBUS_MasterTask_WaitAndSendCommand(MODBUS_t *handle);
 void MODBUS_MasterTask_WaitRx(MODBUS_t *handle);
+void MODBUS_MasterTask_Turnaround(MODBUS_t *handle);
 void MODBUS_MasterTask_ElaborateRx(MODBUS_t *handle);
 
 /**************************************************************************************************
  * 										FUNZIONI PRIVATE
  *************************************************************************************************/
 
+/// Sospende il produttore dei byte ricevuti (ISR o DMA), se gira in un altro contesto
+void RxLock(const MODBUS_t *handle) {
+	if (handle->pxPort != NULL && handle->pxPort->lockRx != NULL)
+		handle->pxPort->lockRx(handle->pxPort->context);
+}
+
+void RxUnlock(const MODBUS_t *handle) {
+	if (handle->pxPort != NULL && handle->pxPort->unlockRx != NULL)
+		handle->pxPort->unlockRx(handle->pxPort->context);
+}
+
+/**
+ * Copia nella frame i byte ricevuti e svuota il ring buffer, insieme al CRC calcolato in
+ * ricezione. Lettura, svuotamento e reset del CRC avvengono a produttore sospeso: un byte della
+ * frame successiva finisce o tutto in questa (ed è scartato) o tutto nella prossima.
+ * Una ricezione più lunga della frame massima (rumore, due frame attaccate) viene scartata:
+ * ritorna 0, cioè frame non valida.
+ */
+uint16_t FetchRxFrame(MODBUS_t *handle, uint8_t *raw, uint16_t *rxCRC) {
+	uint16_t length = 0;
+
+	RxLock(handle);
+	*rxCRC = handle->u16RxCRC;
+	if (RingCountBytes(handle->pxRxBuff) <= MODBUS_FRAME_MAX_SIZE)
+		length = RingGetNBytes(handle->pxRxBuff, raw, MODBUS_FRAME_MAX_SIZE);
+
+	RingClear(handle->pxRxBuff);
+	handle->u16RxCRC = MODBUS_CRC_INIT;
+	RxUnlock(handle);
+
+	return length;
+}
+
+/**
+ * Scarta i byte ricevuti finora e l'eventuale fine frame già segnalata, con lo stesso vincolo sul
+ * produttore di FetchRxFrame. Il Master la chiama prima di ogni richiesta e dopo un timeout: una
+ * risposta arrivata in ritardo non deve finire in testa a quella della richiesta successiva.
+ */
+void DiscardRx(MODBUS_t *handle) {
+	RxLock(handle);
+	RingClear(handle->pxRxBuff);
+	handle->u16RxCRC = MODBUS_CRC_INIT;
+	handle->u8RxComplete = 0;
+	RxUnlock(handle);
+}
+
 eMODBUS_Excpt ReadMasterFrame(MODBUS_t *handle, sMaster_Frame *mFrame) {
-	mFrame->u16Length = RingGetAllBytes(handle->pxRxBuff, &mFrame->raw[0]);
+	// Prendiamo la frame con il CRC calcolato in ricezione; il CRC riparte per la prossima
+	uint16_t rxCRC;
+	mFrame->u16Length = FetchRxFrame(handle, &mFrame->raw[0], &rxCRC);
 
 	// Dobbiamo avere almeno 8 byte per una corretta frame MODBUS,
 	// più la corrispondenza dell'indirizzo
-	if (mFrame->u16Length < MASTER_FRAME_LENGTH || mFrame->u8DevID != *handle->u8myAddress)
+	if (mFrame->u16Length < MASTER_FRAME_LENGTH)
+		return Exception_InvalidFrame;
+
+	// In broadcast sono ammesse solo le scritture: una lettura non avrebbe a chi rispondere
+	if (mFrame->u8DevID == MODBUS_BROADCAST_ADDRESS) {
+		if (!IsWriteFunction(mFrame->u8FuncCode))
+			return Exception_InvalidFrame;
+	} else if (mFrame->u8DevID != *handle->u8myAddress) {
 		return Exception_InvalidFrame;
+	}
+
+	uint16_t len = MasterFrameLength(mFrame);
+	if (len == 0)
+		return Exception_IllegalFunc;
 
-	uint8_t len = 0;
+	return CheckFrameCRC(&mFrame->raw[0], len, mFrame->u16Length, rxCRC);
+}
+
+/**
+ * Lunghezza della richiesta del Master, CRC escluso, ricavata dal Function Code.
+ * Ritorna 0 se il Function Code non è supportato.
+ */
+uint16_t MasterFrameLength(const sMaster_Frame *mFrame) {
 	switch (mFrame->u8FuncCode) {
 	case FC_ReadCoilStatus:
 	case FC_ReadDiscreteInputs:
@@ -247,321 +491,1412 @@ eMODBUS_Excpt ReadMasterFrame(MODBUS_t *handle, sMaster_Frame *mFrame) {
 	case FC_ReadInputRegisters:
 	case FC_WriteSingleCoil:
 	case FC_WriteSingleRegister:
-		len = MASTER_HEADER_BYTES;
-		break;
+		return MASTER_HEADER_BYTES;
+
+	case FC_MaskWriteRegister:
+		return MASK_WRITE_BYTES;
 
 	case FC_WriteMultipleCoils:
 	case FC_WriteMultipleRegisters:
 		// La lunghezza è pari alla Header, più il byte del ByteCount,
 		// più il numero di byte indicati dal ByteCount stesso
-		len = MASTER_HEADER_BYTES + mFrame->u8ByteCount + 1;
-		break;
+		return MASTER_HEADER_BYTES + mFrame->u8ByteCount + 1;
+
+	case FC_ReadWriteMultipleRegisters:
+		// Dopo la lettura ci sono indirizzo e quantità della scrittura, poi il suo ByteCount
+		return RW_HEADER_BYTES + mFrame->raw[RW_HEADER_BYTES] + 1;
 
 	default:
-		return Exception_IllegalFunc;
-		break;
+		return 0;
 	}
-	uint16_t crc = 0;
-	uint16_t crcRx = 0;
-	crc = calcCRC(&mFrame->raw[0], len);
-
-	// Leggo la parte bassa e alta del CRC ricevuto
-	crcRx = mFrame->raw[len + 0] << 8; 	// Alta
-	crcRx |= mFrame->raw[len + 1];			// Bassa
-
-	// Verifichiamo che il CRC sia corretto
-	if (crc != crcRx)
-		return Exception_InvalidFrame;
-
-	// Tutto a posto
-	return Exception_NoException;
 }
 
 eMODBUS_Excpt ReadSlaveFrame(MODBUS_t *const handle, sSlave_Frame *sFrame) {
-	sFrame->u16Length = RingGetAllBytes(handle->pxRxBuff, &sFrame->raw[0]);
+	uint16_t rxCRC;
+	sFrame->u16Length = FetchRxFrame(handle, &sFrame->raw[0], &rxCRC);
 
 	if (sFrame->u16Length < SLAVE_FRAME_LENGTH)
 		return Exception_InvalidFrame;
 
-	uint8_t len = 0;
+	uint16_t len = SlaveFrameLength(sFrame);
+	if (len == 0)
+		return Exception_IllegalFunc;
+
+	return CheckFrameCRC(&sFrame->raw[0], len, sFrame->u16Length, rxCRC);
+}
+
+/**
+ * Lunghezza della risposta dello Slave, CRC escluso, ricavata dal Function Code.
+ * Ritorna 0 se il Function Code non è supportato.
+ */
+uint16_t SlaveFrameLength(const sSlave_Frame *sFrame) {
 	switch (sFrame->u8FuncCode) {
 	// La lunghezza è varibile in base a quanti byte sono stati letti
 	case FC_ReadCoilStatus:
 	case FC_ReadDiscreteInputs:
 	case FC_ReadHoldingRegisters:
 	case FC_ReadInputRegisters:
-		len = SLAVE_HEADER_BYTES + sFrame->u8ByteCount;
-		break;
+	case FC_ReadWriteMultipleRegisters:
+		return SLAVE_HEADER_BYTES + sFrame->u8ByteCount;
 
 		// Le frame sono tutte lunghe 6 byte + 2b CRC, come una Master Frame
 	case FC_WriteSingleCoil:
 	case FC_WriteSingleRegister:
 	case FC_WriteMultipleCoils:
 	case FC_WriteMultipleRegisters:
-		len = MASTER_HEADER_BYTES;	// Gli ultimi 2 byte sono il CRC, da escludere
-		break;
+		return MASTER_HEADER_BYTES;	// Gli ultimi 2 byte sono il CRC, da escludere
+
+	case FC_MaskWriteRegister:
+		return MASK_WRITE_BYTES;
 
 	default:
-		return Exception_IllegalFunc;
-		break;
+		// Eccezione dello slave: solo il codice dopo il Function Code
+		if (sFrame->u8FuncCode & 0x80)
+			return SLAVE_HEADER_BYTES;
+		return 0;
 	}
-
-	uint16_t crc = 0;
-	uint16_t crcRx = 0;
-	crc = calcCRC(&sFrame->raw[0], len);
-
-	// Leggo la parte bassa e alta del CRC ricevuto
-	crcRx = sFrame->raw[len + 0] << 8; 	// Alta
-	crcRx |= sFrame->raw[len + 1];			// Bassa
-
-	// Verifichiamo che il CRC sia corretto
-	if (crc != crcRx)
-		return Exception_InvalidFrame;
-
-	// Tutto a posto
-	return Exception_NoException;
 }
 
 /**
- * @brief Questa funzione imposta una sSlave_Frame partedo dalla mFrame.
+ * Confronta una risposta integra con il comando spedito: deve venire dallo slave interrogato ed
+ * avere lo stesso Function Code, oppure essere la sua eccezione. Le scritture sono l'eco della
+ * richiesta, quindi indirizzo e valore/quantità devono coincidere.
+ * @return Exception_NoException, l'eccezione riportata dallo slave, oppure Exception_InvalidFrame
  */
-sSlave_Frame setupExceptionFrame(const sMaster_Frame *mFrame, eMODBUS_Excpt excpt) {
-	sSlave_Frame sFrame;
+eMODBUS_Excpt CheckResponse(const sMODBUS_Commmand *cmd, const sSlave_Frame *sFrame) {
+	if (sFrame->u8DevID != cmd->slaveID)
+		return Exception_InvalidFrame;
 
-	// Imposta il primo bit del FC a 1 per segnalare l'eccezione
-	sFrame.u8DevID = mFrame->u8DevID;
-	sFrame.u8FuncCode = 0x80 | mFrame->u8FuncCode;
+	// Eccezione: il codice è nella posizione del ByteCount
+	if (sFrame->u8FuncCode == (0x80 | cmd->functionCode))
+		return (sFrame->u8ByteCount != 0) ? sFrame->u8ByteCount : Exception_InvalidFrame;
 
-	// Nel pacchetto, l'eccezione ha la stessa posizione del byte di ByteCount
-	sFrame.u8ByteCount = excpt;
+	if (sFrame->u8FuncCode != cmd->functionCode)
+		return Exception_InvalidFrame;
 
-	uint16_t crc = calcCRC(&sFrame.raw[0], 3);
-	sFrame.raw[3] = crc >> 8;
-	sFrame.raw[4] = crc;
-	sFrame.u16Length = 5;
+	switch (cmd->functionCode) {
+	case FC_WriteSingleCoil:
+	case FC_WriteSingleRegister:
+	case FC_WriteMultipleCoils:
+	case FC_WriteMultipleRegisters:
+		if (((sFrame->raw[2] << 8) | sFrame->raw[3]) != cmd->regAddress
+				|| ((sFrame->raw[4] << 8) | sFrame->raw[5]) != RequestField(cmd))
+			return Exception_InvalidFrame;
+		break;
+	case FC_MaskWriteRegister:
+		if (((sFrame->raw[2] << 8) | sFrame->raw[3]) != cmd->regAddress
+				|| ((sFrame->raw[4] << 8) | sFrame->raw[5]) != cmd->u16Value
+				|| ((sFrame->raw[6] << 8) | sFrame->raw[7]) != cmd->u16OrMask)
+			return Exception_InvalidFrame;
+		break;
+	default:
+		break;
+	}
 
-	return sFrame;
+	return Exception_NoException;
 }
 
-sSlave_Frame ReadValues(MODBUS_t *handle, const sMaster_Frame *mFrame) {
-	uint16_t readLength = (mFrame->u8Length_High << 8) + mFrame->u8Length_Low;
-	uint16_t AddressOffset = (mFrame->u8AddressHigh << 8) + mFrame->u8AddressLow;
-	uint16_t u16EndAdd = AddressOffset + readLength;
-
-	// Con questo switch selezioniamo il tipo di informazioni che si vogliono elaborare:
-	// grazie ai puntatori a funzione tutto il resto del codice rimane uguale per tutte
-	// le tipologie di lettura. Effettivamente il codice è comune; se si fossero implementate
-	// 4 funzioni diverse si avrebbe avuto molto codice doppiato.
+/**
+ * @relates MODBUS_MasterTask_ElaborateRx
+ * @brief Consegna all'applicazione i dati di una risposta, tramite le funzioni remote del tipo
+ * di registro richiesto dal comando. Se è impostata la funzione a blocchi, l'intera risposta
+ * arriva con una sola chiamata e quella per singolo registro non viene usata.
+ */
+eMODBUS_Excpt DeliverResponse(MODBUS_t *handle, const sMODBUS_Commmand *cmd,
+		sSlave_Frame *sFrame, uint16_t firstAddress) {
 	sRegister SelectedReg;
-	switch (mFrame->u8FuncCode) {
+	uint16_t offset = cmd->regAddress - firstAddress;
+	uint16_t bytes;
+	uint8_t perRegister;
+	uint8_t table = sFrame->u8FuncCode;
+
+	switch (sFrame->u8FuncCode) {
 	case FC_ReadCoilStatus:
 		SelectedReg = handle->coils;
+		bytes = (offset + cmd->length + 7) / 8;
 		break;
 	case FC_ReadDiscreteInputs:
 		SelectedReg = handle->discretes;
+		bytes = (offset + cmd->length + 7) / 8;
 		break;
 	case FC_ReadHoldingRegisters:
 		SelectedReg = handle->holdings;
+		bytes = (offset + cmd->length) * 2;
 		break;
 	case FC_ReadInputRegisters:
 		SelectedReg = handle->inputs;
+		bytes = (offset + cmd->length) * 2;
 		break;
+	case FC_ReadWriteMultipleRegisters:
+		// La parte letta è uguale ad una FC3
+		SelectedReg = handle->holdings;
+		bytes = (offset + cmd->length) * 2;
+		table = FC_ReadHoldingRegisters;
+		break;
+	default:
+		return Exception_NoException;
 	}
 
-	sSlave_Frame sFrame;
-	sFrame.u8DevID = mFrame->u8DevID;
-	sFrame.u8FuncCode = mFrame->u8FuncCode;
-	sFrame.u8ByteCount = 0;
-	sFrame.u16Length = 3;
-
-	for (uint16_t u16Add = AddressOffset, reps = 0; u16Add < u16EndAdd; u16Add++, reps++) {
-		sMODBUS_ReadResult result;
-		bytesFields data;
-
-		// La funzione reading deve essere implementata lato utente: è quella che fa da collante
-		// tra questa libreria MODBUS (che non deve essere modificata) e i dati dell'applicazione,
-		// scritti e salvati in formati non compatibili con le specifiche MODBUS.
-		// In questo modo possiamo raccimolare dati da qualsiasi cella di memoria, anche non
-		// contigue, e farle sembrare contigue per il protocollo MODBUS.
-		result = SelectedReg.reading(u16Add);
+	// Risposta più corta della richiesta: non consegnamo dati letti oltre la frame
+	if (sFrame->u8ByteCount < bytes)
+		return Exception_InvalidFrame;
 
-		if (result.error != Exception_NoException)
-			return setupExceptionFrame(mFrame, result.error);
+	perRegister = SelectedReg.remote != NULL;
+	if (SelectedReg.remoteRegs != NULL) {
+		perRegister = 0;
+		const uint8_t *payload = &sFrame->raw[SLAVE_HEADER_BYTES + offset * 2];
+		uint16_t *values = handle->blockScratch.au16Regs;
+
+		for (uint16_t i = 0; i < cmd->length; i++)
+			values[i] = (payload[2 * i] << 8) | payload[2 * i + 1];
+		SelectedReg.remoteRegs(cmd->slaveID, cmd->regAddress, cmd->length, values);
+	} else if (SelectedReg.remoteBits != NULL) {
+		perRegister = 0;
+		const uint8_t *payload = &sFrame->raw[SLAVE_HEADER_BYTES];
+		uint8_t *bits = handle->blockScratch.au8Bits;
+
+		// Bitmap già allineata (caso comune, nessuna fusione di letture): la passiamo così com'è
+		if (offset == 0 && cmd->length % 8 == 0) {
+			SelectedReg.remoteBits(cmd->slaveID, cmd->regAddress, cmd->length, payload);
+		} else {
+			Bitmap_Extract(bits, payload, offset, cmd->length);
+			SelectedReg.remoteBits(cmd->slaveID, cmd->regAddress, cmd->length, bits);
+		}
+	}
 
-		// Passiamo i dati e le ripetizioni del ciclo; queste ultime servono per coils/discretes
-		// per formattare correttamente i bytes della frame
-		data.u16[0] = result.data;
-		data.u16[1] = reps;
+	if (!perRegister && handle->pxCache == NULL)
+		return Exception_NoException;
 
-		SelectedReg.appendData(&sFrame, data);
+	for (uint16_t addr = 0; addr < cmd->length; addr++) {
+		uint16_t data = SelectedReg.readPayload(sFrame, offset + addr);
+		if (perRegister)
+			SelectedReg.remote(cmd->slaveID, cmd->regAddress + addr, data);
+		if (handle->pxCache != NULL)
+			CacheStore(handle->pxCache, cmd->slaveID, table, cmd->regAddress + addr, data,
+					handle->u32TickMs);
 	}
 
-	FrameSlave_AppendCRC(&sFrame);
-
-	return sFrame;
+	return Exception_NoException;
 }
 
 /**
- * @relates MODBUS_SlaveTask
- * #brief Funzione che gestisce i Function-Codes MODBUS che eseguono una scrittura di una singola
- * cella di memoria.
+ * Lettura della risposta ad una transazione raw: qualsiasi Function Code è accettato, purché
+ * la frame venga dallo slave interrogato, sia la risposta alla stessa funzione (anche come
+ * eccezione) e il CRC sia corretto. In uscita u16Length esclude il CRC.
  */
-sSlave_Frame WriteSingle(MODBUS_t *handle, const sMaster_Frame *mFrame) {
-	// In questo caso i dati sono al posto della ReadLength
-	uint16_t u16WriteAdd = (mFrame->u8AddressHigh << 8) + mFrame->u8AddressLow;
-	uint16_t u16Data = (mFrame->u8Length_High << 8) + mFrame->u8Length_Low;
-
-	// Con questo switch selezioniamo il tipo di informazioni che si vogliono elaborare:
-	// grazie ai puntatori a funzione tutto il resto del codice rimane uguale per le varie
-	// tipologie di scrittura.
-	sRegister SelectedReg;
-	switch (mFrame->u8FuncCode) {
-	case FC_WriteSingleCoil:
-		SelectedReg = handle->coils;
-		if (u16Data == 0xFF00)
-			u16Data = 1;
-		else if (u16Data == 0x0000)
-			u16Data = 0;
-		else
-			return setupExceptionFrame(mFrame, Exception_InvalidDataValue);
-		break;
+eMODBUS_Excpt ReadRawFrame(MODBUS_t *handle, sSlave_Frame *sFrame) {
+	uint16_t rxCRC;
+	sFrame->u16Length = FetchRxFrame(handle, &sFrame->raw[0], &rxCRC);
 
-	case FC_WriteSingleRegister:
-		SelectedReg = handle->inputs;
-		break;
-	}
+	// Indirizzo, Function Code, almeno un byte di dati e CRC
+	if (sFrame->u16Length < SLAVE_HEADER_BYTES + 2 || sFrame->u8DevID != handle->lastCmd.slaveID
+			|| (sFrame->u8FuncCode & 0x7F) != handle->lastCmd.functionCode)
+		return Exception_InvalidFrame;
 
-	eMODBUS_Excpt error = SelectedReg.writing(u16WriteAdd, u16Data);
+	sFrame->u16Length -= 2;
+	return CheckFrameCRC(&sFrame->raw[0], sFrame->u16Length, sFrame->u16Length + 2, rxCRC);
+}
 
-	if (error != Exception_NoException)
-		return setupExceptionFrame(mFrame, error);
+/// Chiude la transazione raw in corso e ne notifica l'esito
+void FinishRawTransaction(MODBUS_t *handle, eMODBUS_Excpt error, const uint8_t *response,
+		uint16_t length) {
+	MODBUS_RawResponse done = handle->rawDone;
 
-	// Tutto ok. Setup della risposta, che è esattamente uguale alla richiesta.
-	// Quindi ne facciamo una copia brutale brutale, usando il buffer RAW
-	sSlave_Frame sFrame;
-	sFrame.u16Length = 6;
-	memcpy(&sFrame.raw[0], &mFrame->raw[0], mFrame->u16Length);
-	FrameSlave_AppendCRC(&sFrame);
-	return sFrame;
+	// La callback potrebbe avviare subito un'altra transazione: liberiamo prima lo stato
+	handle->rawDone = NULL;
+	done(handle->rawContext, error, response, length);
 }
 
-/* Il problema nell'unificare le due funzioni di WriteMultiple è che varia drasticamente
- * l'esecuzione del ciclo for. Per ovviare a questo problema si dovrebbero creare due
- * 'if()' per identificare le coils e i registri... di fatto implementando due funzioni
- * in una sola. Non ha senso. Anche coi puntatori a funzione dovrebbero essere passati come minimo
- * 4 parametri, quindi creando delle funzioni "troppo grosse".
- * Non ho trovato implementazione migliore per tenere il codice DRY.
- */
+/// Due comandi di lettura identici: la risposta di uno vale anche per l'altro
+uint8_t IsSameRead(const sMODBUS_Commmand *cmd, const sMODBUS_Commmand *other) {
+	if (cmd->functionCode < FC_ReadCoilStatus || cmd->functionCode > FC_ReadInputRegisters)
+		return 0;
 
-sSlave_Frame WriteMultipleCoils(MODBUS_t *handle, const sMaster_Frame *mFrame) {
-	uint16_t writeLength = (mFrame->u8Length_High << 8) + mFrame->u8Length_Low;
-	uint16_t AddressOffset = (mFrame->u8AddressHigh << 8) + mFrame->u8AddressLow;
-	uint16_t u16EndAdd = AddressOffset + writeLength;
+	return cmd->functionCode == other->functionCode && cmd->slaveID == other->slaveID
+			&& cmd->regAddress == other->regAddress && cmd->length == other->length;
+}
 
-	// ReadIndex lo facciamo partire 1 byte prima rispetto alla posizione reale del payload,
-	// perché lo incrementiamo immediatamente alla prima ripetizione del ciclo for.
-	// Effettivamente i dati partono dal byte 7 della frame (cioè mFrame->raw[7]).
-	uint16_t readIndex = 6;
-	for (uint16_t u16Add = AddressOffset, reps = 0; u16Add < u16EndAdd; u16Add++, reps++) {
-		// Abbiamo terminato di leggere questo byte, passiamo al successivo.
-		if (reps % 8 == 0)
-			readIndex++;
+/**
+ * La stessa lettura è già in attesa di risposta, sulla seriale o sul trasporto esterno: la sua
+ * risposta viene consegnata alle funzioni remote dell'oggetto, che sono le stesse per tutti i
+ * comandi, quindi basta una volta.
+ */
+uint8_t IsReadInFlight(const MODBUS_t *handle, const sMODBUS_Commmand *cmd) {
+	if (handle->uxMode == MODBUS_Mode_Master && handle->task != MODBUS_MasterTask_WaitAndSendCommand
+			&& handle->rawDone == NULL) {
+		if (IsSameRead(cmd, &handle->lastCmd))
+			return 1;
+		for (uint8_t i = 0; i < handle->u8MergedReads; i++) {
+			if (IsSameRead(cmd, &handle->mergedReads[i]))
+				return 1;
+		}
+	}
 
-		// Estrae il singolo bit dal byte della frame.
-		bytesFields data;
-		data.u16[0] = (mFrame->raw[readIndex] >> (reps % 8)) & 0x01;
-		handle->coils.writing(u16Add, data.u16[0]);
+	for (uint8_t slot = 0; handle->inFlight != NULL && slot < handle->u8InFlightSlots; slot++) {
+		const sMODBUS_Commmand *sent = handle->inFlight(handle->inFlightContext, slot);
+		if (sent != NULL && IsSameRead(cmd, sent))
+			return 1;
 	}
 
-	// Tutto ok. Setup della risposta, che è uguale ai primi 6 byte della richiesta.
-	// Quindi ne facciamo una copia brutale brutale, usando il buffer RAW
-	sSlave_Frame sFrame;
-	sFrame.u16Length = 6;
-	memcpy(&sFrame.raw[0], &mFrame->raw[0], mFrame->u16Length);
-	FrameSlave_AppendCRC(&sFrame);
-	return sFrame;
+	return 0;
 }
 
-sSlave_Frame WriteMultipleRegisters(MODBUS_t *handle, const sMaster_Frame *mFrame) {
-	uint16_t writeLength = (mFrame->u8Length_High << 8) + mFrame->u8Length_Low;
-	uint16_t AddressOffset = (mFrame->u8AddressHigh << 8) + mFrame->u8AddressLow;
-	uint16_t u16EndAdd = AddressOffset + writeLength;
-
-	// ReadIndex identifica la posizione dalla quale partono i dati della frame master
-	// (cioè mFrame->raw[7]). Lo incrementiamo di 2 ad ogni ripetizione per muoverci sui dati u16
-	uint16_t readIndex = 7;
-	for (uint16_t u16Add = AddressOffset; u16Add < u16EndAdd; u16Add++, readIndex += 2) {
-
-		bytesFields data;
-
-		// Inversione dovuta al Big-Endian MODBUS / Little-Endian ARM
-		data.u8[0] = mFrame->raw[readIndex + 1];
-		data.u8[1] = mFrame->raw[readIndex + 0];
-
-		eMODBUS_Excpt error = handle->inputs.writing(u16Add, data.u16[0]);
+/**
+ * Livello di priorità in cui la stessa lettura è già in coda.
+ * @return Il livello più urgente che la contiene, MODBUS_PRIORITY_LEVELS se non è in coda
+ */
+uint8_t QueuedReadLevel(const MODBUS_t *handle, const sMODBUS_Commmand *cmd) {
+	sMODBUS_Commmand queued;
 
-		// Check dell'errore; con questa implementazione, però, i dati precedenti all'eccezione
-		// sono ugualmente scritti nella memoria. Non so se sia corretto oppure no.
-		if (error != Exception_NoException)
-			return setupExceptionFrame(mFrame, error);
+	for (uint8_t level = 0; level < MODBUS_PRIORITY_LEVELS; level++) {
+		for (uint16_t i = 0; q_peekIdx(&handle->commands[level], &queued, i); i++) {
+			if (IsSameRead(cmd, &queued))
+				return level;
+		}
 	}
 
-	// Tutto ok. Setup della risposta, che è uguale ai primi 6 byte della richiesta.
-	// Quindi ne facciamo una copia brutale brutale, usando il buffer RAW
-	sSlave_Frame sFrame;
-	sFrame.u16Length = 6;
-	memcpy(&sFrame.raw[0], &mFrame->raw[0], mFrame->u16Length);
-	FrameSlave_AppendCRC(&sFrame);
-	return sFrame;
+	return MODBUS_PRIORITY_LEVELS;
 }
 
 /**
- * @relates sRegister
- * @brief Funzione per l'accodamento dei dati nella frame Slave di risposta ad una richiesta
- * ricevuta precedentemente da un MASTER.
+ * Toglie dalla coda del livello la lettura uguale a cmd, lasciando gli altri comandi nell'ordine
+ * in cui erano. La coda non permette rimozioni nel mezzo: la si fa ruotare una volta intera.
  */
-void FrameSlave_AppendCoil(sSlave_Frame *sFrame, bytesFields data) {
-	// Quando il rimanente è zero aumentiamo di 1 byte la frame.
-	// Lo facciamo subito per allocare lo spazio al byte dati delle coils.
-	// Siccome il buffer è statico, può avere dentro ancora i dati precedenti.
-	// Prima di aggiungere il nuovo byte faccio un azzeramento, così elimino i dati vecchi
-	if (data.u16[1] % 8 == 0) {
-		sFrame->raw[sFrame->u16Length] = 0;
-		sFrame->u16Length += 1;
-		sFrame->u8ByteCount += 1;
+void DropQueuedRead(MODBUS_t *handle, uint8_t level, const sMODBUS_Commmand *cmd) {
+	Queue_t *queue = &handle->commands[level];
+	sMODBUS_Commmand queued;
+	uint8_t dropped = 0;
+
+	for (uint16_t count = q_getCount(queue); count > 0; count--) {
+		q_pop(queue, &queued);
+		if (!dropped && IsSameRead(cmd, &queued))
+			dropped = 1;
+		else
+			q_push(queue, &queued);
 	}
-
-	// In data.u16[0] abbiamo i dati, mentre in data.u16[1] abbiamo lo shift del bit di coil
-	// Viene calcolato il rimanente % 8 sullo shift per riempire un singolo byte
-	// Usiamo Length - 1 perché gli array sono indicizzati a 0
-	sFrame->raw[sFrame->u16Length - 1] |= (data.u16[0] & 0x01) << (data.u16[1] % 8);
 }
 
 /**
- * @relates sRegister
- * Funzione per l'accodamento dei dati nella frame Slave di risposta ad una richiesta
- * ricevuta precedentemente da un MASTER.
+ * Estrae il prossimo comando accodato: quello del livello più urgente non vuoto, a meno che un
+ * livello meno urgente abbia già lasciato passare PRIORITY_STARVATION_LIMIT comandi.
+ * Il costo non dipende dal numero di comandi in coda.
+ * @return 1 se è stato estratto un comando, 0 se tutte le code sono vuote
  */
-void FrameSlave_AppendRegister(sSlave_Frame *sFrame, bytesFields data) {
-	// Allocazione in Big-Endian; ARM gestisce in Little-Endian. Per questo invertiamo i byte
-	// I dati sono nei primi 16 bit
-	sFrame->raw[sFrame->u16Length + 0] = data.u8[1];
-	sFrame->raw[sFrame->u16Length + 1] = data.u8[0];
+uint8_t CommandPop(MODBUS_t *handle, sMODBUS_Commmand *cmd) {
+	uint8_t level = MODBUS_PRIORITY_LEVELS;
 
-	sFrame->u16Length += 2;
-	sFrame->u8ByteCount += 2;
-}
+	for (uint8_t i = 0; i < MODBUS_PRIORITY_LEVELS && level == MODBUS_PRIORITY_LEVELS; i++) {
+		if (!q_isEmpty(&handle->commands[i]))
+			level = i;
+	}
 
-uint16_t FrameSlave_ReadCoils(sSlave_Frame *sFrame, uint16_t address) {
-	uint8_t bitNum = address % 8;
-	uint8_t byteNum = address / 8 + SLAVE_HEADER_BYTES;
+	if (level == MODBUS_PRIORITY_LEVELS)
+		return 0;
 
-	return ((sFrame->raw[byteNum] & (1 << bitNum)) != 0) ? 1 : 0;
+	// Livello in attesa da troppo tempo: cominciamo dal meno urgente, che ha aspettato di più
+	for (uint8_t i = MODBUS_PRIORITY_LEVELS - 1; i > level; i--) {
+		if (handle->au8Skipped[i] >= PRIORITY_STARVATION_LIMIT && !q_isEmpty(&handle->commands[i])) {
+			level = i;
+			break;
+		}
+	}
+
+	q_pop(&handle->commands[level], cmd);
+	handle->u8CmdLevel = level;
+	handle->au8Skipped[level] = 0;
 
+	for (uint8_t i = level + 1; i < MODBUS_PRIORITY_LEVELS; i++) {
+		if (!q_isEmpty(&handle->commands[i]))
+			handle->au8Skipped[i]++;
+	}
+
+	return 1;
 }
 
-uint16_t FrameSlave_ReadRegisters(sSlave_Frame *sFrame, uint16_t address) {
-	// Protocollo Big-Endian: prima leggo il byte alto e dopo quello basso
+/**
+ * Sceglie, tra le voci di polling da spedire, quella con la scadenza più vicina (EDF).
+ * Se la voce parte oltre la fine del suo periodo, i periodi persi vengono contati e saltati:
+ * la voce resta allineata alla sua fase invece di accumulare richieste arretrate.
+ * @return 1 se cmd contiene il comando da spedire, 0 se nessuna voce è da spedire
+ */
+uint8_t PollSchedule(MODBUS_t *handle, sMODBUS_Commmand *cmd) {
+	sMODBUS_PollEntry *next = NULL;
+	int32_t nextSlack = 0;
+	uint32_t now = handle->u32TickMs;
+
+	for (uint16_t i = 0; i < handle->u16PollEntries; i++) {
+		sMODBUS_PollEntry *entry = &handle->pxPollTable[i];
+
+		if (!PollIsDue(handle, entry))
+			continue;
+
+		// Dati già letti di recente (da un altro comando): saltiamo questo giro
+		if (CacheIsFresh(handle, &entry->cmd)) {
+			PollConsume(handle, entry);
+			continue;
+		}
+
+		int32_t slack = (int32_t) (entry->u32Release + entry->u16PeriodMs - now);
+		if (next == NULL || slack < nextSlack) {
+			next = entry;
+			nextSlack = slack;
+		}
+	}
+
+	if (next == NULL)
+		return 0;
+
+	PollConsume(handle, next);
+	*cmd = next->cmd;
+	return 1;
+}
+
+/// Lettura fallita: i valori in cache restano gli ultimi validi, ma segnati con l'errore
+void CacheMarkError(MODBUS_t *handle, const sMODBUS_Commmand *cmd, eMODBUS_Excpt error) {
+	if (handle->pxCache == NULL || cmd->functionCode < FC_ReadCoilStatus
+			|| cmd->functionCode > FC_ReadInputRegisters)
+		return;
+
+	for (uint16_t addr = 0; addr < cmd->length; addr++)
+		CacheSetError(handle->pxCache, cmd->slaveID, cmd->functionCode, cmd->regAddress + addr,
+				error);
+}
+
+/// Tutti gli indirizzi della lettura sono in cache, senza errori e più giovani del TTL
+uint8_t CacheIsFresh(const MODBUS_t *handle, const sMODBUS_Commmand *cmd) {
+	if (handle->pxCache == NULL || cmd->functionCode < FC_ReadCoilStatus
+			|| cmd->functionCode > FC_ReadInputRegisters)
+		return 0;
+
+	for (uint16_t addr = 0; addr < cmd->length; addr++) {
+		const sCacheEntry *entry = CacheFind(handle->pxCache, cmd->slaveID, cmd->functionCode,
+				cmd->regAddress + addr);
+
+		if (entry == NULL || entry->u8Error != 0
+				|| handle->u32TickMs - entry->u32Timestamp >= handle->u16CacheTtlMs)
+			return 0;
+	}
+
+	return 1;
+}
+
+uint8_t PollIsDue(const MODBUS_t *handle, const sMODBUS_PollEntry *entry) {
+	return (int32_t) (handle->u32TickMs - entry->u32Release) >= 0;
+}
+
+/// La voce è stata spedita: passa al periodo successivo, contando quelli persi
+void PollConsume(MODBUS_t *handle, sMODBUS_PollEntry *entry) {
+	uint32_t late = handle->u32TickMs - entry->u32Release;
+
+	if (late >= entry->u16PeriodMs) {
+		uint32_t missed = late / entry->u16PeriodMs;
+		entry->u16Missed += missed;
+		handle->u32PollMissed += missed;
+		entry->u32Release += missed * entry->u16PeriodMs;
+	}
+	entry->u32Release += entry->u16PeriodMs;
+}
+
+/**
+ * Prova ad unire la lettura cmd a quella in merged: stesso slave e Function Code, distanza entro
+ * u16MergeGap e lunghezza totale entro i limiti del protocollo.
+ * @return 1 se cmd è stata unita (merged viene allargata), 0 altrimenti
+ */
+uint8_t MergeRead(const MODBUS_t *handle, sMODBUS_Commmand *merged, const sMODBUS_Commmand *cmd) {
+	uint16_t maxLength;
+
+	if (cmd->slaveID != merged->slaveID || cmd->functionCode != merged->functionCode)
+		return 0;
+
+	switch (cmd->functionCode) {
+	case FC_ReadCoilStatus:
+	case FC_ReadDiscreteInputs:
+		maxLength = MAX_READ_BITS;
+		break;
+	case FC_ReadHoldingRegisters:
+	case FC_ReadInputRegisters:
+		maxLength = MAX_READ_REGISTERS;
+		break;
+	default:
+		return 0;
+	}
+
+	// Calcoli a 32 bit: gli estremi possono superare 0xFFFF
+	uint32_t first = (cmd->regAddress < merged->regAddress) ? cmd->regAddress : merged->regAddress;
+	uint32_t mergedEnd = (uint32_t) merged->regAddress + merged->length;
+	uint32_t cmdEnd = (uint32_t) cmd->regAddress + cmd->length;
+	uint32_t end = (cmdEnd > mergedEnd) ? cmdEnd : mergedEnd;
+
+	// Indirizzi non richiesti tra le due letture (0 se si toccano o si sovrappongono)
+	uint32_t gap = 0;
+	if (cmd->regAddress > mergedEnd)
+		gap = cmd->regAddress - mergedEnd;
+	else if (merged->regAddress > cmdEnd)
+		gap = merged->regAddress - cmdEnd;
+
+	if (gap > handle->u16MergeGap || end - first > maxLength)
+		return 0;
+
+	merged->regAddress = first;
+	merged->length = end - first;
+	return 1;
+}
+
+/**
+ * Unisce a lastCmd le letture compatibili in testa alla coda e le voci di polling da spedire.
+ * Le letture originali restano in mergedReads: la risposta viene consegnata a ciascuna, senza i
+ * dati degli indirizzi non richiesti.
+ */
+void CoalesceReads(MODBUS_t *handle) {
+	sMODBUS_Commmand merged = handle->lastCmd;
+	sMODBUS_Commmand next;
+
+	handle->mergedReads[0] = handle->lastCmd;
+	handle->u8MergedReads = 1;
+
+	// Dalla coda di lastCmd, solo in testa: i comandi non uniti mantengono il loro ordine
+	if (handle->u8CmdLevel < MODBUS_PRIORITY_LEVELS) {
+		Queue_t *queue = &handle->commands[handle->u8CmdLevel];
+
+		while (handle->u8MergedReads < MERGED_READS && q_peek(queue, &next)
+				&& MergeRead(handle, &merged, &next)) {
+			q_drop(queue);
+			handle->mergedReads[handle->u8MergedReads++] = next;
+		}
+	}
+
+	for (uint16_t i = 0; i < handle->u16PollEntries && handle->u8MergedReads < MERGED_READS; i++) {
+		sMODBUS_PollEntry *entry = &handle->pxPollTable[i];
+
+		if (PollIsDue(handle, entry) && MergeRead(handle, &merged, &entry->cmd)) {
+			PollConsume(handle, entry);
+			handle->mergedReads[handle->u8MergedReads++] = entry->cmd;
+		}
+	}
+
+	if (handle->u8MergedReads == 1) {
+		handle->u8MergedReads = 0;
+		return;
+	}
+
+	handle->lastCmd = merged;
+}
+
+/**
+ * Unisce a lastCmd, se è una scrittura singola, le scritture singole in testa alla sua coda allo
+ * stesso slave e agli indirizzi successivi. I valori sono copiati in combinedWrite, a cui punta
+ * la scrittura multipla che prende il posto di lastCmd.
+ */
+void CombineWrites(MODBUS_t *handle) {
+	sMODBUS_Commmand *cmd = &handle->lastCmd;
+	sMODBUS_Commmand next = *cmd;
+	uint8_t isCoil = (cmd->functionCode == FC_WriteSingleCoil);
+	uint16_t maxLength = isCoil ? MAX_WRITE_BITS : MAX_WRITE_REGISTERS;
+	uint16_t count = 0;
+
+	if (handle->u8CmdLevel >= MODBUS_PRIORITY_LEVELS
+			|| (!isCoil && cmd->functionCode != FC_WriteSingleRegister))
+		return;
+
+	Queue_t *queue = &handle->commands[handle->u8CmdLevel];
+	if (isCoil)
+		memset(handle->combinedWrite.au8Bits, 0, sizeof(handle->combinedWrite.au8Bits));
+
+	for (;;) {
+		if (!isCoil)
+			handle->combinedWrite.au16Regs[count] = next.u16Value;
+		else if (next.u16Value != 0)
+			handle->combinedWrite.au8Bits[count / 8] |= 1 << (count % 8);
+		count++;
+
+		if (count == maxLength || !q_peek(queue, &next) || next.functionCode != cmd->functionCode
+				|| next.slaveID != cmd->slaveID || next.regAddress != cmd->regAddress + count)
+			break;
+		q_drop(queue);
+	}
+
+	if (count == 1)
+		return;
+
+	cmd->functionCode = isCoil ? FC_WriteMultipleCoils : FC_WriteMultipleRegisters;
+	cmd->length = count;
+	cmd->pvData = &handle->combinedWrite;
+}
+
+/// Function Code che scrive soltanto, e quindi può essere spedito in broadcast
+uint8_t IsWriteFunction(uint8_t funcCode) {
+	switch (funcCode) {
+	case FC_WriteSingleCoil:
+	case FC_WriteSingleRegister:
+	case FC_WriteMultipleCoils:
+	case FC_WriteMultipleRegisters:
+	case FC_MaskWriteRegister:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+/// Le scritture multiple devono avere i dati e restare nei limiti del protocollo; in broadcast
+/// si possono solo scrivere
+uint8_t IsValidCommand(const sMODBUS_Commmand *cmd) {
+	if (cmd->slaveID == MODBUS_BROADCAST_ADDRESS && !IsWriteFunction(cmd->functionCode))
+		return 0;
+
+	switch (cmd->functionCode) {
+	case FC_WriteMultipleCoils:
+		return cmd->pvData != NULL && cmd->length != 0 && cmd->length <= MAX_WRITE_BITS;
+	case FC_WriteMultipleRegisters:
+		return cmd->pvData != NULL && cmd->length != 0 && cmd->length <= MAX_WRITE_REGISTERS;
+	case FC_ReadWriteMultipleRegisters:
+		return cmd->pvData != NULL && cmd->length != 0 && cmd->length <= MAX_READ_REGISTERS
+				&& cmd->u16WriteLength != 0 && cmd->u16WriteLength <= MAX_RW_WRITE_REGISTERS;
+	default:
+		return 1;
+	}
+}
+
+/// Secondo campo a 16 bit della richiesta: il valore per le scritture singole, altrimenti la quantità
+uint16_t RequestField(const sMODBUS_Commmand *cmd) {
+	switch (cmd->functionCode) {
+	case FC_WriteSingleCoil:
+		return (cmd->u16Value != 0) ? 0xFF00 : 0x0000;
+	case FC_WriteSingleRegister:
+	case FC_MaskWriteRegister:
+		return cmd->u16Value;
+	default:
+		return cmd->length;
+	}
+}
+
+/// Scrittura confermata dallo slave: la cache delle letture riporta subito i nuovi valori
+void CacheStoreWrite(MODBUS_t *handle, const sMODBUS_Commmand *cmd) {
+	const uint8_t *bits = cmd->pvData;
+	const uint16_t *regs = cmd->pvData;
+	const sCacheEntry *cached;
+
+	if (handle->pxCache == NULL)
+		return;
+
+	switch (cmd->functionCode) {
+	case FC_WriteSingleCoil:
+		CacheStore(handle->pxCache, cmd->slaveID, FC_ReadCoilStatus, cmd->regAddress,
+				cmd->u16Value != 0, handle->u32TickMs);
+		break;
+	case FC_WriteSingleRegister:
+		CacheStore(handle->pxCache, cmd->slaveID, FC_ReadHoldingRegisters, cmd->regAddress,
+				cmd->u16Value, handle->u32TickMs);
+		break;
+	case FC_WriteMultipleCoils:
+		for (uint16_t i = 0; i < cmd->length; i++)
+			CacheStore(handle->pxCache, cmd->slaveID, FC_ReadCoilStatus, cmd->regAddress + i,
+					(bits[i / 8] >> (i % 8)) & 1, handle->u32TickMs);
+		break;
+	case FC_WriteMultipleRegisters:
+		for (uint16_t i = 0; i < cmd->length; i++)
+			CacheStore(handle->pxCache, cmd->slaveID, FC_ReadHoldingRegisters, cmd->regAddress + i,
+					regs[i], handle->u32TickMs);
+		break;
+	case FC_MaskWriteRegister:
+		// Il nuovo valore si conosce solo partendo da quello in cache
+		cached = CacheFind(handle->pxCache, cmd->slaveID, FC_ReadHoldingRegisters, cmd->regAddress);
+		if (cached != NULL && cached->u8Error == 0)
+			CacheStore(handle->pxCache, cmd->slaveID, FC_ReadHoldingRegisters, cmd->regAddress,
+					(cached->u16Value & cmd->u16Value) | (cmd->u16OrMask & ~cmd->u16Value),
+					handle->u32TickMs);
+		break;
+	case FC_ReadWriteMultipleRegisters:
+		// I registri riletti nella stessa transazione sono già in cache, con il valore più recente
+		for (uint16_t i = 0; i < cmd->u16WriteLength; i++) {
+			uint16_t address = cmd->u16WriteAddress + i;
+			if ((uint16_t) (address - cmd->regAddress) >= cmd->length)
+				CacheStore(handle->pxCache, cmd->slaveID, FC_ReadHoldingRegisters, address, regs[i],
+						handle->u32TickMs);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * Silenzio di fine frame, in tempi-bit, per il baudrate della porta: fino a 19200 baud è quello
+ * passato (multiplo del tempo di carattere), sopra è il tempo fisso della specifica.
+ */
+uint16_t SilenceBits(const MODBUS_t *handle, uint16_t bits, uint32_t fixedUs) {
+	uint32_t baudrate = (handle->pxPort != NULL) ? handle->pxPort->u32Baudrate : 0;
+
+	if (baudrate <= FIXED_TIMING_BAUDRATE)
+		return bits;
+
+	// Centinaia di baud: niente overflow a 32 bit anche con baudrate molto alti
+	return (fixedUs * (baudrate / 100) + 9999) / 10000;
+}
+
+/// Timeout di risposta per lo slave: stima adattativa se attiva, altrimenti RX_TIMEOUT_ms
+uint16_t ResponseTimeout(const MODBUS_t *handle, uint8_t slaveID) {
+	if (handle->pxTiming == NULL)
+		return RX_TIMEOUT_ms;
+
+	const sSlaveTiming *timing = &handle->pxTiming[slaveID];
+	if (!timing->u8Valid)
+		return handle->u16TimeoutCeilingMs;
+
+	uint32_t timeout = (timing->u16Srtt8 >> 3) + (timing->u16RttVar4 * RTT_DEVIATION_GAIN) / 4;
+	if (timeout < handle->u16TimeoutFloorMs)
+		return handle->u16TimeoutFloorMs;
+	if (timeout > handle->u16TimeoutCeilingMs)
+		return handle->u16TimeoutCeilingMs;
+	return timeout;
+}
+
+void ResponseTimeoutStart(MODBUS_t *handle, uint8_t slaveID) {
+	handle->u16RxTimeoutSet = ResponseTimeout(handle, slaveID);
+	handle->u16RxTimeout = handle->u16RxTimeoutSet;
+}
+
+/**
+ * Lo slave ha risposto: il tempo trascorso aggiorna media (guadagno 1/8) e deviazione (1/4).
+ * Il timeout conta solo a trasmissione finita, quindi la differenza è il tempo di risposta.
+ */
+void ResponseTimeSample(MODBUS_t *handle, uint8_t slaveID) {
+	if (handle->pxTiming == NULL)
+		return;
+
+	sSlaveTiming *timing = &handle->pxTiming[slaveID];
+	int32_t rtt = handle->u16RxTimeoutSet - handle->u16RxTimeout;
+
+	if (!timing->u8Valid) {
+		timing->u16Srtt8 = rtt * 8;
+		timing->u16RttVar4 = rtt * 2;
+		timing->u8Valid = 1;
+		return;
+	}
+
+	int32_t delta = rtt - (timing->u16Srtt8 >> 3);
+	timing->u16Srtt8 += delta;
+	if (delta < 0)
+		delta = -delta;
+	timing->u16RttVar4 += delta - (timing->u16RttVar4 >> 2);
+}
+
+/// Lo slave non ha risposto in tempo: la deviazione raddoppia, e con essa il margine
+void ResponseTimeLost(MODBUS_t *handle, uint8_t slaveID) {
+	if (handle->pxTiming == NULL || !handle->pxTiming[slaveID].u8Valid)
+		return;
+
+	sSlaveTiming *timing = &handle->pxTiming[slaveID];
+	uint32_t rttVar4 = (timing->u16RttVar4 != 0) ? timing->u16RttVar4 * 2 : 4;
+	uint32_t maxVar4 = (uint32_t) handle->u16TimeoutCeilingMs * 4;
+
+	timing->u16RttVar4 = (rttVar4 > maxVar4) ? maxVar4 : rttVar4;
+}
+
+/**
+ * Lo slave può ricevere una richiesta: è in linea, oppure è in backoff ed è ora della sonda.
+ * La sonda successiva viene spostata in avanti subito, così ne parte una sola per intervallo.
+ */
+uint8_t SlaveMayTransmit(MODBUS_t *handle, uint8_t slaveID) {
+	if (handle->pxHealth == NULL)
+		return 1;
+
+	sSlaveHealth *slave = &handle->pxHealth[slaveID];
+	if (!slave->status.u8Offline)
+		return 1;
+	if ((int32_t) (handle->u32TickMs - slave->u32NextProbe) < 0)
+		return 0;
+
+	slave->u32NextProbe = handle->u32TickMs + slave->status.u16BackoffMs;
+	return 1;
+}
+
+/// Risposta valida (anche un'eccezione): lo slave è in linea
+void SlaveAnswered(MODBUS_t *handle, uint8_t slaveID) {
+	if (handle->pxHealth == NULL)
+		return;
+
+	sSlaveHealth *slave = &handle->pxHealth[slaveID];
+	slave->status.u8Failures = 0;
+	slave->status.u8Offline = 0;
+	slave->status.u16BackoffMs = 0;
+}
+
+/// Timeout o frame non valida: troppi di fila mandano lo slave in backoff, una sonda fallita lo allunga
+void SlaveFailed(MODBUS_t *handle, uint8_t slaveID, uint8_t timeout) {
+	if (handle->pxHealth == NULL)
+		return;
+
+	sSlaveHealth *slave = &handle->pxHealth[slaveID];
+	if (timeout)
+		slave->status.u16Timeouts++;
+	else
+		slave->status.u16FrameErrors++;
+	if (slave->status.u8Failures < UINT8_MAX)
+		slave->status.u8Failures++;
+
+	if (slave->status.u8Offline) {
+		uint32_t backoff = (uint32_t) slave->status.u16BackoffMs * 2;
+		slave->status.u16BackoffMs =
+				(backoff > handle->u16BackoffMaxMs) ? handle->u16BackoffMaxMs : backoff;
+	} else if (slave->status.u8Failures >= handle->u8MaxFailures) {
+		slave->status.u8Offline = 1;
+		slave->status.u16BackoffMs = handle->u16BackoffMinMs;
+	} else {
+		return;
+	}
+
+	slave->u32NextProbe = handle->u32TickMs + slave->status.u16BackoffMs;
+}
+
+/**
+ * Verifica del CRC di una frame ricevuta.
+ * @param raw		Dati grezzi della frame
+ * @param len		Lunghezza della frame, CRC escluso, calcolata dal Function Code
+ * @param rxLength	Byte effettivamente ricevuti
+ * @param rxCRC		Registro CRC calcolato in ricezione su tutti i byte (MODBUS_STREAMING_CRC)
+ */
+eMODBUS_Excpt CheckFrameCRC(const uint8_t *raw, uint16_t len, uint16_t rxLength, uint16_t rxCRC) {
+#if MODBUS_STREAMING_CRC
+	// Il CRC è già stato calcolato su tutti i byte ricevuti, CRC compreso: su una frame integra
+	// il residuo è zero. Deve però coprire esattamente la frame, senza byte in più o in meno.
+	(void) raw;
+	if (rxLength != len + 2 || rxCRC != 0)
+		return Exception_InvalidFrame;
+#else
+	(void) rxCRC;
+	if (rxLength < len + 2)
+		return Exception_InvalidFrame;
+
+	uint16_t crc = 0;
+	uint16_t crcRx = 0;
+	crc = calcCRC(&raw[0], len);
+
+	// Leggo la parte bassa e alta del CRC ricevuto
+	crcRx = raw[len + 0] << 8; 	// Alta
+	crcRx |= raw[len + 1];			// Bassa
+
+	// Verifichiamo che il CRC sia corretto
+	if (crc != crcRx)
+		return Exception_InvalidFrame;
+#endif
+
+	// Tutto a posto
+	return Exception_NoException;
+}
+
+/**
+ * @brief Questa funzione imposta una sSlave_Frame partedo dalla mFrame.
+ * Il CRC viene accodato dal chiamante, come per tutte le altre risposte.
+ */
+void setupExceptionFrame(const sMaster_Frame *mFrame, sSlave_Frame *sFrame, eMODBUS_Excpt excpt) {
+	// Imposta il primo bit del FC a 1 per segnalare l'eccezione
+	sFrame->u8DevID = mFrame->u8DevID;
+	sFrame->u8FuncCode = 0x80 | mFrame->u8FuncCode;
+
+	// Nel pacchetto, l'eccezione ha la stessa posizione del byte di ByteCount
+	sFrame->u8ByteCount = excpt;
+	sFrame->u16Length = 3;
+}
+
+/**
+ * @relates MODBUS_SlaveTask
+ * @brief Esegue la richiesta del Master in base al Function Code, costruendo la risposta.
+ */
+eMODBUS_Excpt ExecuteRequest(MODBUS_t *handle, const sMaster_Frame *mFrame, sSlave_Frame *sFrame) {
+	eMODBUS_Excpt error = Exception_IllegalFunc;
+
+	switch (mFrame->u8FuncCode) {
+	case FC_WriteMultipleCoils:
+		error = WriteMultipleCoils(handle, mFrame, sFrame);
+
+		if (handle->writeCmpltCallback != 0)
+			handle->writeCmpltCallback();
+		break;
+	case FC_WriteMultipleRegisters:
+		error = WriteMultipleRegisters(handle, mFrame, sFrame);
+
+		if (handle->writeCmpltCallback != 0)
+			handle->writeCmpltCallback();
+		break;
+	case FC_ReadWriteMultipleRegisters:
+		error = ReadWriteRegisters(handle, mFrame, sFrame);
+
+		if (handle->writeCmpltCallback != 0)
+			handle->writeCmpltCallback();
+		break;
+
+	case FC_ReadCoilStatus:
+	case FC_ReadDiscreteInputs:
+	case FC_ReadHoldingRegisters:
+	case FC_ReadInputRegisters:
+		error = ReadValues(handle, mFrame, sFrame);
+		break;
+
+	case FC_WriteSingleCoil:
+	case FC_WriteSingleRegister:
+		error = WriteSingle(handle, mFrame, sFrame);
+
+		if (handle->writeCmpltCallback != 0)
+			handle->writeCmpltCallback();
+		break;
+
+	case FC_MaskWriteRegister:
+		error = MaskWriteRegister(handle, mFrame, sFrame);
+
+		if (handle->writeCmpltCallback != 0)
+			handle->writeCmpltCallback();
+		break;
+	}
+
+	return error;
+}
+
+eMODBUS_Excpt ReadValues(MODBUS_t *handle, const sMaster_Frame *mFrame, sSlave_Frame *sFrame) {
+	uint16_t readLength = (mFrame->u8Length_High << 8) + mFrame->u8Length_Low;
+	uint16_t AddressOffset = (mFrame->u8AddressHigh << 8) + mFrame->u8AddressLow;
+	uint16_t u16EndAdd = AddressOffset + readLength;
+
+	// Con questo switch selezioniamo il tipo di informazioni che si vogliono elaborare:
+	// grazie ai puntatori a funzione tutto il resto del codice rimane uguale per tutte
+	// le tipologie di lettura. Effettivamente il codice è comune; se si fossero implementate
+	// 4 funzioni diverse si avrebbe avuto molto codice doppiato.
+	sRegister SelectedReg;
+	uint16_t maxLength = MAX_READ_REGISTERS;
+	switch (mFrame->u8FuncCode) {
+	case FC_ReadCoilStatus:
+		SelectedReg = handle->coils;
+		maxLength = MAX_READ_BITS;
+		break;
+	case FC_ReadDiscreteInputs:
+		SelectedReg = handle->discretes;
+		maxLength = MAX_READ_BITS;
+		break;
+	case FC_ReadHoldingRegisters:
+	case FC_ReadWriteMultipleRegisters:
+		SelectedReg = handle->holdings;
+		break;
+	case FC_ReadInputRegisters:
+		SelectedReg = handle->inputs;
+		break;
+	}
+
+	// Quantità fuori dai limiti della specifica: la risposta non starebbe nella frame
+	if (readLength == 0 || readLength > maxLength)
+		return Exception_InvalidDataValue;
+
+	sFrame->u8DevID = mFrame->u8DevID;
+	sFrame->u8FuncCode = mFrame->u8FuncCode;
+	sFrame->u8ByteCount = 0;
+	sFrame->u16Length = 3;
+
+	// Richiesta interamente dentro al banco di memoria: copia diretta, nessuna funzione utente
+	if (Bank_Contains(&SelectedReg.bank, AddressOffset, readLength)) {
+		Bank_ReadToFrame(&SelectedReg.bank, sFrame, AddressOffset, readLength);
+		return Exception_NoException;
+	}
+
+	// Se l'applicazione ha fornito una lettura a blocchi la usiamo: una sola chiamata per tutta
+	// la richiesta, invece di una chiamata per ogni indirizzo.
+	if (SelectedReg.readingRegs != 0)
+		return FrameSlave_AppendRegisterBlock(sFrame, SelectedReg.readingRegs, AddressOffset,
+				readLength, handle->blockScratch.au16Regs);
+	if (SelectedReg.readingBits != 0)
+		return FrameSlave_AppendCoilBlock(sFrame, SelectedReg.readingBits, AddressOffset,
+				readLength);
+
+	for (uint16_t u16Add = AddressOffset, reps = 0; u16Add < u16EndAdd; u16Add++, reps++) {
+		sMODBUS_ReadResult result;
+		bytesFields data;
+
+		// La funzione reading deve essere implementata lato utente: è quella che fa da collante
+		// tra questa libreria MODBUS (che non deve essere modificata) e i dati dell'applicazione,
+		// scritti e salvati in formati non compatibili con le specifiche MODBUS.
+		// In questo modo possiamo raccimolare dati da qualsiasi cella di memoria, anche non
+		// contigue, e farle sembrare contigue per il protocollo MODBUS.
+		result = SelectedReg.reading(u16Add);
+
+		if (result.error != Exception_NoException)
+			return result.error;
+
+		// Passiamo i dati e le ripetizioni del ciclo; queste ultime servono per coils/discretes
+		// per formattare correttamente i bytes della frame
+		data.u16[0] = result.data;
+		data.u16[1] = reps;
+
+		SelectedReg.appendData(sFrame, data);
+	}
+
+	return Exception_NoException;
+}
+
+/**
+ * @relates MODBUS_SlaveTask
+ * #brief Funzione che gestisce i Function-Codes MODBUS che eseguono una scrittura di una singola
+ * cella di memoria.
+ */
+eMODBUS_Excpt WriteSingle(MODBUS_t *handle, const sMaster_Frame *mFrame, sSlave_Frame *sFrame) {
+	// In questo caso i dati sono al posto della ReadLength
+	uint16_t u16WriteAdd = (mFrame->u8AddressHigh << 8) + mFrame->u8AddressLow;
+	uint16_t u16Data = (mFrame->u8Length_High << 8) + mFrame->u8Length_Low;
+
+	// Con questo switch selezioniamo il tipo di informazioni che si vogliono elaborare:
+	// grazie ai puntatori a funzione tutto il resto del codice rimane uguale per le varie
+	// tipologie di scrittura.
+	sRegister SelectedReg;
+	switch (mFrame->u8FuncCode) {
+	case FC_WriteSingleCoil:
+		SelectedReg = handle->coils;
+		if (u16Data == 0xFF00)
+			u16Data = 1;
+		else if (u16Data == 0x0000)
+			u16Data = 0;
+		else
+			return Exception_InvalidDataValue;
+		break;
+
+	case FC_WriteSingleRegister:
+		SelectedReg = handle->inputs;
+		break;
+	}
+
+	eMODBUS_Excpt error = Register_WriteOne(&SelectedReg, u16WriteAdd, u16Data);
+	if (error != Exception_NoException)
+		return error;
+
+	// Tutto ok. Setup della risposta, che è esattamente uguale alla richiesta.
+	FrameSlave_EchoRequest(mFrame, sFrame);
+	return Exception_NoException;
+}
+
+/* Il problema nell'unificare le due funzioni di WriteMultiple è che varia drasticamente
+ * l'esecuzione del ciclo for. Per ovviare a questo problema si dovrebbero creare due
+ * 'if()' per identificare le coils e i registri... di fatto implementando due funzioni
+ * in una sola. Non ha senso. Anche coi puntatori a funzione dovrebbero essere passati come minimo
+ * 4 parametri, quindi creando delle funzioni "troppo grosse".
+ * Non ho trovato implementazione migliore per tenere il codice DRY.
+ */
+
+eMODBUS_Excpt WriteMultipleCoils(MODBUS_t *handle, const sMaster_Frame *mFrame,
+		sSlave_Frame *sFrame) {
+	uint16_t writeLength = (mFrame->u8Length_High << 8) + mFrame->u8Length_Low;
+	uint16_t AddressOffset = (mFrame->u8AddressHigh << 8) + mFrame->u8AddressLow;
+	uint16_t u16EndAdd = AddressOffset + writeLength;
+
+	if (writeLength == 0 || writeLength > MAX_WRITE_BITS
+			|| mFrame->u8ByteCount != (writeLength + 7) / 8)
+		return Exception_InvalidDataValue;
+
+	// La bitmap della frame ha già il formato richiesto dalla scrittura a blocchi: la passiamo
+	// così com'è all'applicazione, con una sola chiamata.
+	if (Bank_Contains(&handle->coils.bank, AddressOffset, writeLength)) {
+		Bitmap_Insert(handle->coils.bank.pu8Bits, AddressOffset - handle->coils.bank.u16Base,
+				&mFrame->u8PayloadStart, writeLength);
+	} else if (handle->coils.writingBits != 0) {
+		eMODBUS_Excpt error = handle->coils.writingBits(AddressOffset, writeLength,
+				&mFrame->u8PayloadStart);
+		if (error != Exception_NoException)
+			return error;
+	} else {
+		WriteCoils_PerAddress(handle, mFrame, AddressOffset, u16EndAdd);
+	}
+
+	// Tutto ok. Setup della risposta, che è uguale ai primi 6 byte della richiesta.
+	FrameSlave_EchoRequest(mFrame, sFrame);
+	return Exception_NoException;
+}
+
+/**
+ * @relates WriteMultipleCoils
+ * @brief Scrittura delle coils una alla volta, tramite la funzione utente per singolo indirizzo.
+ */
+void WriteCoils_PerAddress(MODBUS_t *handle, const sMaster_Frame *mFrame, uint16_t AddressOffset,
+		uint16_t u16EndAdd) {
+	// ReadIndex lo facciamo partire 1 byte prima rispetto alla posizione reale del payload,
+	// perché lo incrementiamo immediatamente alla prima ripetizione del ciclo for.
+	// Effettivamente i dati partono dal byte 7 della frame (cioè mFrame->raw[7]).
+	uint16_t readIndex = 6;
+	for (uint16_t u16Add = AddressOffset, reps = 0; u16Add < u16EndAdd; u16Add++, reps++) {
+		// Abbiamo terminato di leggere questo byte, passiamo al successivo.
+		if (reps % 8 == 0)
+			readIndex++;
+
+		// Estrae il singolo bit dal byte della frame.
+		bytesFields data;
+		data.u16[0] = (mFrame->raw[readIndex] >> (reps % 8)) & 0x01;
+		handle->coils.writing(u16Add, data.u16[0]);
+	}
+}
+
+eMODBUS_Excpt WriteMultipleRegisters(MODBUS_t *handle, const sMaster_Frame *mFrame,
+		sSlave_Frame *sFrame) {
+	uint16_t writeLength = (mFrame->u8Length_High << 8) + mFrame->u8Length_Low;
+	uint16_t AddressOffset = (mFrame->u8AddressHigh << 8) + mFrame->u8AddressLow;
+
+	if (writeLength == 0 || writeLength > MAX_WRITE_REGISTERS
+			|| mFrame->u8ByteCount != writeLength * 2)
+		return Exception_InvalidDataValue;
+
+	eMODBUS_Excpt error = WriteRegisterBlock(handle, AddressOffset, writeLength,
+			&mFrame->u8PayloadStart);
+	if (error != Exception_NoException)
+		return error;
+
+	// Tutto ok. Setup della risposta, che è uguale ai primi 6 byte della richiesta.
+	FrameSlave_EchoRequest(mFrame, sFrame);
+	return Exception_NoException;
+}
+
+/**
+ * @relates MODBUS_SlaveTask
+ * @brief FC22: il registro diventa (valore AND andMask) OR (orMask AND NOT andMask).
+ * Con la funzione di mascheratura dell'applicazione l'operazione è atomica anche rispetto agli
+ * altri contesti; senza, è una lettura dalla tabella della FC3 seguita da una scrittura in
+ * quella della FC6, come farebbe un master con le due richieste separate.
+ */
+eMODBUS_Excpt MaskWriteRegister(MODBUS_t *handle, const sMaster_Frame *mFrame,
+		sSlave_Frame *sFrame) {
+	uint16_t address = (mFrame->u8AddressHigh << 8) + mFrame->u8AddressLow;
+	uint16_t andMask = (mFrame->u8Length_High << 8) + mFrame->u8Length_Low;
+	uint16_t orMask = (mFrame->raw[6] << 8) + mFrame->raw[7];
+	const sRegister *reg = &handle->inputs;
+	eMODBUS_Excpt error = Exception_NoException;
+
+	// Scrittura nella stessa tabella della FC6
+	if (!Bank_Contains(&reg->bank, address, 1) && reg->writingMask != 0) {
+		error = reg->writingMask(address, andMask, orMask);
+	} else {
+		sMODBUS_ReadResult current = Register_ReadOne(&handle->holdings, address);
+		uint16_t value = (current.data & andMask) | (orMask & ~andMask);
+		error = current.error;
+		if (error == Exception_NoException)
+			error = Register_WriteOne(reg, address, value);
+	}
+
+	if (error != Exception_NoException)
+		return error;
+
+	// La risposta è l'eco della richiesta, maschere comprese
+	memcpy(&sFrame->raw[0], &mFrame->raw[0], MASK_WRITE_BYTES);
+	sFrame->u16Length = MASK_WRITE_BYTES;
+	return Exception_NoException;
+}
+
+/**
+ * @relates MODBUS_SlaveTask
+ * @brief FC23: scrittura di un blocco di registri e lettura di un altro, nella stessa transazione.
+ * La scrittura viene eseguita per prima, come da specifica, e la risposta è quella di una FC3.
+ */
+eMODBUS_Excpt ReadWriteRegisters(MODBUS_t *handle, const sMaster_Frame *mFrame,
+		sSlave_Frame *sFrame) {
+	uint16_t readLength = (mFrame->u8Length_High << 8) + mFrame->u8Length_Low;
+	uint16_t writeAddress = (mFrame->raw[6] << 8) + mFrame->raw[7];
+	uint16_t writeLength = (mFrame->raw[8] << 8) + mFrame->raw[9];
+
+	if (readLength == 0 || readLength > MAX_READ_REGISTERS || writeLength == 0
+			|| writeLength > MAX_RW_WRITE_REGISTERS
+			|| mFrame->raw[RW_HEADER_BYTES] != writeLength * 2)
+		return Exception_InvalidDataValue;
+
+	eMODBUS_Excpt error = WriteRegisterBlock(handle, writeAddress, writeLength,
+			&mFrame->raw[RW_HEADER_BYTES + 1]);
+	if (error != Exception_NoException)
+		return error;
+
+	return ReadValues(handle, mFrame, sFrame);
+}
+
+/**
+ * @relates WriteMultipleRegisters
+ * @brief Scrittura di registri consecutivi, con i valori in Big-Endian come nella frame.
+ */
+eMODBUS_Excpt WriteRegisterBlock(MODBUS_t *handle, uint16_t AddressOffset, uint16_t writeLength,
+		const uint8_t *payload) {
+	// Scrittura a blocchi: decodifichiamo tutti i registri (Big-Endian MODBUS -> macchina)
+	// e li passiamo all'applicazione in un colpo solo, così può validarli e salvarli insieme.
+	const sRegBank *bank = &handle->inputs.bank;
+	if (Bank_Contains(bank, AddressOffset, writeLength)) {
+		uint16_t *dest = &bank->pu16Regs[AddressOffset - bank->u16Base];
+
+		for (uint16_t i = 0; i < writeLength; i++)
+			dest[i] = (payload[2 * i] << 8) | payload[2 * i + 1];
+	} else if (handle->inputs.writingRegs != 0) {
+		uint16_t *values = handle->blockScratch.au16Regs;
+
+		for (uint16_t i = 0; i < writeLength; i++)
+			values[i] = (payload[2 * i] << 8) | payload[2 * i + 1];
+
+		return handle->inputs.writingRegs(AddressOffset, writeLength, values);
+	} else {
+		return WriteRegisters_PerAddress(handle, payload, AddressOffset,
+				AddressOffset + writeLength);
+	}
+
+	return Exception_NoException;
+}
+
+/**
+ * @relates WriteMultipleRegisters
+ * @brief Scrittura dei registri uno alla volta, tramite la funzione utente per singolo indirizzo.
+ */
+eMODBUS_Excpt WriteRegisters_PerAddress(MODBUS_t *handle, const uint8_t *payload,
+		uint16_t AddressOffset, uint16_t u16EndAdd) {
+	// ReadIndex identifica la posizione del registro nei dati della frame master.
+	// Lo incrementiamo di 2 ad ogni ripetizione per muoverci sui dati u16
+	uint16_t readIndex = 0;
+	for (uint16_t u16Add = AddressOffset; u16Add < u16EndAdd; u16Add++, readIndex += 2) {
+
+		bytesFields data;
+
+		// Inversione dovuta al Big-Endian MODBUS / Little-Endian ARM
+		data.u8[0] = payload[readIndex + 1];
+		data.u8[1] = payload[readIndex + 0];
+
+		eMODBUS_Excpt error = handle->inputs.writing(u16Add, data.u16[0]);
+
+		// Check dell'errore; con questa implementazione, però, i dati precedenti all'eccezione
+		// sono ugualmente scritti nella memoria. Non so se sia corretto oppure no.
+		if (error != Exception_NoException)
+			return error;
+	}
+
+	return Exception_NoException;
+}
+
+/**
+ * @brief Risposta alle scritture: è uguale ai primi 6 byte della richiesta.
+ * Quindi ne facciamo una copia brutale brutale, usando il buffer RAW
+ */
+void FrameSlave_EchoRequest(const sMaster_Frame *mFrame, sSlave_Frame *sFrame) {
+	memcpy(&sFrame->raw[0], &mFrame->raw[0], MASTER_HEADER_BYTES);
+	sFrame->u16Length = MASTER_HEADER_BYTES;
+}
+
+/**
+ * @relates sRegister
+ * @brief Funzione per l'accodamento dei dati nella frame Slave di risposta ad una richiesta
+ * ricevuta precedentemente da un MASTER.
+ */
+void FrameSlave_AppendCoil(sSlave_Frame *sFrame, bytesFields data) {
+	// Quando il rimanente è zero aumentiamo di 1 byte la frame.
+	// Lo facciamo subito per allocare lo spazio al byte dati delle coils.
+	// Siccome il buffer è statico, può avere dentro ancora i dati precedenti.
+	// Prima di aggiungere il nuovo byte faccio un azzeramento, così elimino i dati vecchi
+	if (data.u16[1] % 8 == 0) {
+		sFrame->raw[sFrame->u16Length] = 0;
+		sFrame->u16Length += 1;
+		sFrame->u8ByteCount += 1;
+	}
+
+	// In data.u16[0] abbiamo i dati, mentre in data.u16[1] abbiamo lo shift del bit di coil
+	// Viene calcolato il rimanente % 8 sullo shift per riempire un singolo byte
+	// Usiamo Length - 1 perché gli array sono indicizzati a 0
+	sFrame->raw[sFrame->u16Length - 1] |= (data.u16[0] & 0x01) << (data.u16[1] % 8);
+}
+
+/**
+ * @relates sRegister
+ * Funzione per l'accodamento dei dati nella frame Slave di risposta ad una richiesta
+ * ricevuta precedentemente da un MASTER.
+ */
+void FrameSlave_AppendRegister(sSlave_Frame *sFrame, bytesFields data) {
+	// Allocazione in Big-Endian; ARM gestisce in Little-Endian. Per questo invertiamo i byte
+	// I dati sono nei primi 16 bit
+	sFrame->raw[sFrame->u16Length + 0] = data.u8[1];
+	sFrame->raw[sFrame->u16Length + 1] = data.u8[0];
+
+	sFrame->u16Length += 2;
+	sFrame->u8ByteCount += 2;
+}
+
+/**
+ * @relates sRegister
+ * @brief Accoda alla frame Slave un blocco di registri letti con una sola chiamata utente.
+ * I valori arrivano nell'endianess della macchina, in values (almeno length elementi),
+ * e vengono convertiti in Big-Endian.
+ */
+eMODBUS_Excpt FrameSlave_AppendRegisterBlock(sSlave_Frame *sFrame, MODBUS_LocalReadRegs readFn,
+		uint16_t address, uint16_t length, uint16_t *values) {
+	eMODBUS_Excpt error = readFn(address, length, values);
+	if (error != Exception_NoException)
+		return error;
+
+	uint8_t *dest = &sFrame->raw[sFrame->u16Length];
+	for (uint16_t i = 0; i < length; i++) {
+		dest[2 * i + 0] = values[i] >> 8;
+		dest[2 * i + 1] = values[i] & 0xff;
+	}
+
+	sFrame->u16Length += 2 * length;
+	sFrame->u8ByteCount += 2 * length;
+	return Exception_NoException;
+}
+
+/**
+ * @relates sRegister
+ * @brief Accoda alla frame Slave un blocco di coils/discretes letti con una sola chiamata utente.
+ * La bitmap ha già il formato del protocollo, quindi l'utente scrive direttamente nella frame.
+ */
+eMODBUS_Excpt FrameSlave_AppendCoilBlock(sSlave_Frame *sFrame, MODBUS_LocalReadBits readFn,
+		uint16_t address, uint16_t length) {
+	uint8_t *dest = &sFrame->raw[sFrame->u16Length];
+	uint16_t bytes = (length + 7) / 8;
+
+	memset(dest, 0, bytes);
+	eMODBUS_Excpt error = readFn(address, length, dest);
+	if (error != Exception_NoException)
+		return error;
+
+	// Eventuali bit oltre la quantità richiesta devono essere a zero, come da specifica
+	if (length % 8 != 0)
+		dest[bytes - 1] &= (1 << (length % 8)) - 1;
+
+	sFrame->u16Length += bytes;
+	sFrame->u8ByteCount += bytes;
+	return Exception_NoException;
+}
+
+/**
+ * @relates sRegister
+ * @brief Lettura di un singolo registro della tabella: dal banco se lo contiene, altrimenti con
+ * la funzione utente per indirizzo o, se l'applicazione ha fornito solo quella, con la lettura a
+ * blocchi di lunghezza 1.
+ */
+sMODBUS_ReadResult Register_ReadOne(const sRegister *reg, uint16_t address) {
+	sMODBUS_ReadResult result = { .data = 0, .error = Exception_NoException };
+
+	if (Bank_Contains(&reg->bank, address, 1))
+		result.data = reg->bank.pu16Regs[address - reg->bank.u16Base];
+	else if (reg->reading == dummyReadingFunction && reg->readingRegs != 0)
+		result.error = reg->readingRegs(address, 1, &result.data);
+	else
+		result = reg->reading(address);
+
+	return result;
+}
+
+/**
+ * @relates sRegister
+ * @brief Scrittura di un singolo valore (registro o bit) nella tabella, con lo stesso ordine di
+ * preferenza della lettura: banco, funzione per indirizzo, funzione a blocchi di lunghezza 1.
+ */
+eMODBUS_Excpt Register_WriteOne(const sRegister *reg, uint16_t address, uint16_t value) {
+	uint8_t bit = value & 0x01;
+
+	if (Bank_Contains(&reg->bank, address, 1)) {
+		uint16_t offset = address - reg->bank.u16Base;
+		if (reg->bank.u8IsBits)
+			Bitmap_Insert(reg->bank.pu8Bits, offset, &bit, 1);
+		else
+			reg->bank.pu16Regs[offset] = value;
+		return Exception_NoException;
+	}
+
+	if (reg->writing == dummyWritingFunction) {
+		if (reg->writingBits != 0)
+			return reg->writingBits(address, 1, &bit);
+		if (reg->writingRegs != 0)
+			return reg->writingRegs(address, 1, &value);
+	}
+
+	return reg->writing(address, value);
+}
+
+/**
+ * @relates sRegBank
+ * @brief Verifica se l'intervallo [address, address + length) cade interamente nel banco.
+ */
+INLINE uint8_t Bank_Contains(const sRegBank *bank, uint16_t address, uint16_t length) {
+	if (bank->u16Size == 0 || address < bank->u16Base)
+		return 0;
+
+	return (uint32_t) (address - bank->u16Base) + length <= bank->u16Size;
+}
+
+/**
+ * @relates sRegBank
+ * @brief Copia i dati del banco nella frame Slave di risposta, già nel formato del protocollo.
+ */
+void Bank_ReadToFrame(const sRegBank *bank, sSlave_Frame *sFrame, uint16_t address,
+		uint16_t length) {
+	uint16_t offset = address - bank->u16Base;
+	uint8_t *dest = &sFrame->raw[sFrame->u16Length];
+	uint16_t bytes;
+
+	if (bank->u8IsBits) {
+		bytes = (length + 7) / 8;
+		Bitmap_Extract(dest, bank->pu8Bits, offset, length);
+	} else {
+		// Allocazione in Big-Endian, come in FrameSlave_AppendRegister
+		const uint16_t *src = &bank->pu16Regs[offset];
+		bytes = 2 * length;
+		for (uint16_t i = 0; i < length; i++) {
+			dest[2 * i + 0] = src[i] >> 8;
+			dest[2 * i + 1] = src[i] & 0xff;
+		}
+	}
+
+	sFrame->u16Length += bytes;
+	sFrame->u8ByteCount += bytes;
+}
+
+/**
+ * Copia count bit da src (a partire dal bit srcBit) in dest, allineati al bit 0 del primo byte.
+ * I bit in eccesso dell'ultimo byte di dest sono azzerati, come richiesto dal protocollo.
+ */
+void Bitmap_Extract(uint8_t *dest, const uint8_t *src, uint16_t srcBit, uint16_t count) {
+	const uint8_t *start = &src[srcBit / 8];
+	uint8_t shift = srcBit % 8;
+	uint16_t bytes = (count + 7) / 8;
+
+	if (shift == 0) {
+		memcpy(dest, start, bytes);
+	} else {
+		// Ogni byte di destinazione è a cavallo di due byte sorgente. Il secondo si legge solo
+		// se serve davvero, per non uscire dal banco sull'ultimo byte.
+		for (uint16_t i = 0; i < bytes; i++) {
+			uint8_t value = start[i] >> shift;
+			if (i * 8 + (8 - shift) < count)
+				value |= start[i + 1] << (8 - shift);
+			dest[i] = value;
+		}
+	}
+
+	if (count % 8 != 0)
+		dest[bytes - 1] &= (1 << (count % 8)) - 1;
+}
+
+/**
+ * Scrive count bit di src (allineati al bit 0 del primo byte) in dest, a partire dal bit destBit.
+ * I bit di dest fuori dall'intervallo rimangono invariati.
+ */
+void Bitmap_Insert(uint8_t *dest, uint16_t destBit, const uint8_t *src, uint16_t count) {
+	uint16_t i = 0;
+
+	// Caso allineato: copiamo direttamente i byte interi, poi i bit rimanenti uno alla volta
+	if (destBit % 8 == 0) {
+		memcpy(&dest[destBit / 8], src, count / 8);
+		i = count - (count % 8);
+	}
+
+	for (; i < count; i++) {
+		uint16_t bit = destBit + i;
+		if ((src[i / 8] >> (i % 8)) & 0x01)
+			dest[bit / 8] |= 1 << (bit % 8);
+		else
+			dest[bit / 8] &= ~(1 << (bit % 8));
+	}
+}
+
+uint16_t FrameSlave_ReadCoils(sSlave_Frame *sFrame, uint16_t address) {
+	uint8_t bitNum = address % 8;
+	uint8_t byteNum = address / 8 + SLAVE_HEADER_BYTES;
+
+	return ((sFrame->raw[byteNum] & (1 << bitNum)) != 0) ? 1 : 0;
+
+}
+
+uint16_t FrameSlave_ReadRegisters(sSlave_Frame *sFrame, uint16_t address) {
+	// Protocollo Big-Endian: prima leggo il byte alto e dopo quello basso
 	uint8_t hiByte = address * 2 + SLAVE_HEADER_BYTES;
 	uint8_t loByte = hiByte + 1;
 
@@ -588,57 +1923,62 @@ void FrameMaster_AppendCRC(sMaster_Frame *mFrame) {
 	mFrame->u16Length += 2;
 }
 
-sMaster_Frame FrameMaster_FromCommand(sMODBUS_Commmand *cmd) {
-	sMaster_Frame mFrame;
-	mFrame.u8DevID = cmd->slaveID;
-	mFrame.u8FuncCode = cmd->functionCode;
-	mFrame.u8AddressHigh = cmd->regAddress >> 8;
-	mFrame.u8AddressLow = cmd->regAddress & 0xff;
-	mFrame.u8Length_High = cmd->length >> 8;
-	mFrame.u8Length_Low = cmd->length & 0xff;
-	mFrame.u16Length = MASTER_HEADER_BYTES;
-	FrameMaster_AppendCRC(&mFrame);
-
-	return mFrame;
+void FrameMaster_FromCommand(const sMODBUS_Commmand *cmd, sMaster_Frame *mFrame) {
+	mFrame->u16Length = MODBUS_BuildRequest(cmd, &mFrame->raw[0]);
+	FrameMaster_AppendCRC(mFrame);
 }
 
-/**
- * Funzione di appoggio che esegue i calcoli matematici del CRC del MODBUS.
- */
-uint16_t calcCRC(const uint8_t *Buffer, uint8_t u8length) {
-	uint16_t temp, temp2, flag;
-	temp = 0xFFFF;
-	for (uint8_t i = 0; i < u8length; i++) {
-		temp = temp ^ Buffer[i];
-		for (uint8_t j = 1; j <= 8; j++) {
-			flag = temp & 0x0001;
-			temp >>= 1;
-			if (flag)
-				temp ^= 0xA001;
-		}
-	}
-	// Reverse byte order.
-	temp2 = temp >> 8;
-	temp = (temp << 8) | temp2;
-	temp &= 0xFFFF;
-	// the returned value is already swapped
-	// crcLo byte is first & crcHi byte is last
-	return temp;
+/// Libera l'oggetto MODBUS e tutto quello che ha allocato; gli oggetti mai creati sono NULL
+void FreeHandle(MODBUS_t *handle) {
+	for (uint8_t level = 0; level < MODBUS_PRIORITY_LEVELS; level++)
+		q_kill(&handle->commands[level]);
+	if (handle->pxCache != NULL)
+		CacheDelete(handle->pxCache);
+	if (handle->pxRxBuff != NULL)
+		RingDelete(handle->pxRxBuff);
+	free(handle->pxTiming);
+	free(handle->pxHealth);
+	free(handle);
 }
 
 sMODBUS_ReadResult dummyReadingFunction(const uint16_t address) {
+	(void) address;
+
 	// Ritorna un'eccezione per indicare un problema nell'implementazione delle funzioni
 	sMODBUS_ReadResult result = { .data = 0, .error = Exception_IllegalFunc };
 	return result;
 }
 
 eMODBUS_Excpt dummyWritingFunction(const uint16_t address, const uint16_t data) {
+	(void) address;
+	(void) data;
+
 	// Ritorna un'eccezione per indicare un problema nell'implementazione delle funzioni
 	return Exception_IllegalFunc;
 }
 
 void dummyTxData(const MODBUS_t *handle, const uint8_t *data, const uint8_t len) {
+	(void) handle;
+	(void) data;
+	(void) len;
+}
+
+// Trasmissione di default: passa la frame al driver della porta. Se il driver non la avvia,
+// MODBUS_SetTxComplete non verrebbe mai chiamata: i buffer tornano subito liberi
+void portTxData(const MODBUS_t *handle, const uint8_t *data, const uint8_t len) {
+	if (!handle->pxPort->transmit(handle->pxPort->context, data, len))
+		((MODBUS_t*) handle)->u8TxBusy = 0;
+}
+
+/**
+ * Avvia la trasmissione di una frame. In modalità asincrona segna i buffer come occupati
+ * prima di chiamare l'hardware, perché la notifica di fine TX potrebbe arrivare subito.
+ */
+void StartTx(MODBUS_t *handle, const uint8_t *data, uint16_t length) {
+	if (handle->u8TxAsync)
+		handle->u8TxBusy = 1;
 
+	handle->hwDataTx(handle, data, length);
 }
 
 /**************************************************************************************************
@@ -646,21 +1986,37 @@ void dummyTxData(const MODBUS_t *handle, const uint8_t *data, const uint8_t len)
  *************************************************************************************************/
 /** @brief Crea un nuovo oggetto MODBUS; racchiude tutte le impostazioni del protocollo.
  * N.B.: Allocato dinamicamente! Non inserire in loop o interrupt questa funzione!
+ * @param port Driver della porta, deve restare valido per tutta la vita dell'oggetto.
+ * Con NULL l'oggetto non ha hardware: la trasmissione va impostata con MODBUS_SetHwDataTx.
+ * @return NULL se la porta non può essere aperta
  */
-MODBUS_t* MODBUS_NewHandle(UART_HandleTypeDef *port) {
+MODBUS_t* MODBUS_NewHandle(const sMODBUS_Port *port) {
+	// Setting della porta - il driver prepara l'hardware e la ricezione
+	if (port != NULL && port->open != NULL && !port->open(port->context))
+		return NULL;
+
 	MODBUS_t *handle = calloc(1, sizeof(struct sMODBUS));
-	handle->pxRxBuff = RingNew(32);
-
-	// Setting della porta - Abilitiamo gli interrupt del timer e il timer stesso
-	handle->pxCom = port;
-	__HAL_UART_FLUSH_DRREGISTER(port);
-	__HAL_UART_CLEAR_IT(port, UART_CLEAR_PEF);
-	__HAL_UART_CLEAR_IT(port, UART_CLEAR_FEF);
-	__HAL_UART_CLEAR_IT(port, UART_CLEAR_NEF);
-	__HAL_UART_CLEAR_IT(port, UART_CLEAR_OREF);
-	__HAL_UART_ENABLE_IT(port, UART_IT_RXNE);
-	handle->pxCom->Instance->CR1 |= USART_CR1_RTOIE;
-	handle->pxCom->Instance->CR2 |= USART_CR2_RTOEN;
+	uint8_t allocated = (handle != NULL);
+
+	if (allocated) {
+		handle->pxRxBuff = RingNew(MODBUS_FRAME_MAX_SIZE);
+		allocated = (handle->pxRxBuff != NULL);
+	}
+	for (uint8_t level = 0; allocated && level < MODBUS_PRIORITY_LEVELS; level++)
+		allocated = (q_init(&handle->commands[level], sizeof(sMODBUS_Commmand), QUEUED_COMMANDS,
+				FIFO, false) != NULL);
+
+	if (!allocated) {
+		if (handle != NULL)
+			FreeHandle(handle);
+		if (port != NULL && port->close != NULL)
+			port->close(port->context);
+		return NULL;
+	}
+
+	handle->u16RxCRC = MODBUS_CRC_INIT;
+	handle->pxPort = port;
+	handle->u16TurnaroundMs = TURNAROUND_DELAY_ms;
 
 	handle->coils.reading = dummyReadingFunction;
 	handle->coils.writing = dummyWritingFunction;
@@ -683,12 +2039,15 @@ MODBUS_t* MODBUS_NewHandle(UART_HandleTypeDef *port) {
 	handle->inputs.readPayload = FrameSlave_ReadRegisters;
 
 	handle->hwDataTx = dummyTxData;
-
-	q_init(&handle->commands, sizeof(sMODBUS_Commmand), QUEUED_COMMANDS, FIFO, false);
+	if (port != NULL && port->transmit != NULL)
+		handle->hwDataTx = portTxData;
 
 	// I nuovi oggetti MODBUS sono impostati come slave per default
 	MODBUS_SetMode(handle, MODBUS_Mode_Slave);
 
+	if (port != NULL && port->enableRx != NULL)
+		port->enableRx(port->context);
+
 	return handle;
 }
 
@@ -696,15 +2055,19 @@ MODBUS_t* MODBUS_NewHandle(UART_HandleTypeDef *port) {
  * @param handle Handle dell'oggetto MODBUS da distruggere
  */
 void MODBUS_DeleteHandle(MODBUS_t *handle) {
-	// Disattiviamo gli interrupt della USART
+	// Fermiamo la porta
 	// Cancelliamo gli oggetti interni, poi cancelliamo l'oggetto MODBUS
-	handle->pxCom->Instance->RTOR = 0;
-	handle->pxCom->Instance->CR1 &= ~USART_CR1_RTOIE;
-	handle->pxCom->Instance->CR2 &= ~USART_CR2_RTOEN;
+	const sMODBUS_Port *port = handle->pxPort;
+	if (port != NULL) {
+		if (port->disableRx != NULL)
+			port->disableRx(port->context);
+		if (port->configTimeout != NULL)
+			port->configTimeout(port->context, 0);
+		if (port->close != NULL)
+			port->close(port->context);
+	}
 
-	q_kill(&handle->commands);
-	free(handle->pxRxBuff);
-	free(handle);
+	FreeHandle(handle);
 }
 
 INLINE void MODBUS_ExecuteTask(MODBUS_t *handle) {
@@ -716,20 +2079,24 @@ INLINE void MODBUS_SetAddress(MODBUS_t *handle, uint8_t *address) {
 }
 
 void MODBUS_SetMode(MODBUS_t *handle, eMODBUS_Mode mode) {
-	uint32_t timeout = 0;
+	uint16_t timeout = 0;
 	uint32_t setup_ok = 0;
 
 	switch (mode) {
 	case MODBUS_Mode_Master:
 		setup_ok = 1;
-		timeout = MASTER_BITS_TIMEOUT;
+		timeout = SilenceBits(handle, MASTER_BITS_TIMEOUT, MASTER_FIXED_TIMEOUT_us);
 		handle->task = MODBUS_MasterTask_WaitAndSendCommand;
-		q_flush(&handle->commands);		// Puliamo per sicurezza
+		// Puliamo per sicurezza
+		for (uint8_t level = 0; level < MODBUS_PRIORITY_LEVELS; level++) {
+			q_flush(&handle->commands[level]);
+			handle->au8Skipped[level] = 0;
+		}
 		break;
 
 	case MODBUS_Mode_Slave:
 		setup_ok = 1;
-		timeout = SLAVE_BITS_TIMEOUT;
+		timeout = SilenceBits(handle, SLAVE_BITS_TIMEOUT, SLAVE_FIXED_TIMEOUT_us);
 		handle->task = MODBUS_SlaveTask;
 		break;
 
@@ -741,7 +2108,8 @@ void MODBUS_SetMode(MODBUS_t *handle, eMODBUS_Mode mode) {
 	// Modalità precedente valida: impostiamo l'hardware
 	if (setup_ok) {
 		handle->uxMode = mode;
-		handle->pxCom->Instance->RTOR = timeout;
+		if (handle->pxPort != NULL && handle->pxPort->configTimeout != NULL)
+			handle->pxPort->configTimeout(handle->pxPort->context, timeout);
 	}
 
 }
@@ -774,8 +2142,8 @@ INLINE eMODBUS_Mode MODBUS_GetMode(const MODBUS_t *handle) {
 	return handle->uxMode;
 }
 
-INLINE UART_HandleTypeDef* MODBUS_GetUART(const MODBUS_t *handle) {
-	return handle->pxCom;
+INLINE const sMODBUS_Port* MODBUS_GetPort(const MODBUS_t *handle) {
+	return handle->pxPort;
 }
 
 /*
@@ -784,12 +2152,27 @@ INLINE UART_HandleTypeDef* MODBUS_GetUART(const MODBUS_t *handle) {
 INLINE void MODBUS_Coils_SetReadingFn(MODBUS_t *handle, MODBUS_LocalRead readFn) {
 	handle->coils.reading = readFn;
 }
+INLINE void MODBUS_Coils_SetBlockReadingFn(MODBUS_t *handle, MODBUS_LocalReadBits readFn) {
+	handle->coils.readingBits = readFn;
+}
 INLINE void MODBUS_Coils_SetWritingFn(MODBUS_t *handle, MODBUS_LocalWrite writeFn) {
 	handle->coils.writing = writeFn;
 }
+INLINE void MODBUS_Coils_SetBlockWritingFn(MODBUS_t *handle, MODBUS_LocalWriteBits writeFn) {
+	handle->coils.writingBits = writeFn;
+}
 INLINE void MODBUS_Coils_SetRemoteFn(MODBUS_t *handle, MODBUS_RemoteData remoteFn) {
 	handle->coils.remote = remoteFn;
 }
+INLINE void MODBUS_Coils_SetBlockRemoteFn(MODBUS_t *handle, MODBUS_RemoteBits remoteFn) {
+	handle->coils.remoteBits = remoteFn;
+}
+void MODBUS_Coils_SetBank(MODBUS_t *handle, uint8_t *bits, uint16_t baseAddress, uint16_t size) {
+	handle->coils.bank.pu8Bits = bits;
+	handle->coils.bank.u16Base = baseAddress;
+	handle->coils.bank.u16Size = size;
+	handle->coils.bank.u8IsBits = 1;
+}
 
 /*
  * DISCRETES' SETTERS
@@ -797,9 +2180,21 @@ INLINE void MODBUS_Coils_SetRemoteFn(MODBUS_t *handle, MODBUS_RemoteData remoteF
 INLINE void MODBUS_Discretes_SetReadingFn(MODBUS_t *handle, MODBUS_LocalRead readFn) {
 	handle->discretes.reading = readFn;
 }
+INLINE void MODBUS_Discretes_SetBlockReadingFn(MODBUS_t *handle, MODBUS_LocalReadBits readFn) {
+	handle->discretes.readingBits = readFn;
+}
 INLINE void MODBUS_Discretes_SetRemoteFn(MODBUS_t *handle, MODBUS_RemoteData remoteFn) {
 	handle->discretes.remote = remoteFn;
 }
+INLINE void MODBUS_Discretes_SetBlockRemoteFn(MODBUS_t *handle, MODBUS_RemoteBits remoteFn) {
+	handle->discretes.remoteBits = remoteFn;
+}
+void MODBUS_Discretes_SetBank(MODBUS_t *handle, uint8_t *bits, uint16_t baseAddress, uint16_t size) {
+	handle->discretes.bank.pu8Bits = bits;
+	handle->discretes.bank.u16Base = baseAddress;
+	handle->discretes.bank.u16Size = size;
+	handle->discretes.bank.u8IsBits = 1;
+}
 
 /*
  * HOLDINGS' SETTERS
@@ -807,9 +2202,21 @@ INLINE void MODBUS_Discretes_SetRemoteFn(MODBUS_t *handle, MODBUS_RemoteData rem
 INLINE void MODBUS_Holdings_SetReadingFn(MODBUS_t *handle, MODBUS_LocalRead readFn) {
 	handle->holdings.reading = readFn;
 }
+INLINE void MODBUS_Holdings_SetBlockReadingFn(MODBUS_t *handle, MODBUS_LocalReadRegs readFn) {
+	handle->holdings.readingRegs = readFn;
+}
 INLINE void MODBUS_Holdings_SetRemoteFn(MODBUS_t *handle, MODBUS_RemoteData remoteFn) {
 	handle->holdings.remote = remoteFn;
 }
+INLINE void MODBUS_Holdings_SetBlockRemoteFn(MODBUS_t *handle, MODBUS_RemoteRegs remoteFn) {
+	handle->holdings.remoteRegs = remoteFn;
+}
+void MODBUS_Holdings_SetBank(MODBUS_t *handle, uint16_t *regs, uint16_t baseAddress, uint16_t size) {
+	handle->holdings.bank.pu16Regs = regs;
+	handle->holdings.bank.u16Base = baseAddress;
+	handle->holdings.bank.u16Size = size;
+	handle->holdings.bank.u8IsBits = 0;
+}
 
 /*
  * INPUTS' SETTERS
@@ -817,22 +2224,41 @@ INLINE void MODBUS_Holdings_SetRemoteFn(MODBUS_t *handle, MODBUS_RemoteData remo
 INLINE void MODBUS_Inputs_SetReadingFn(MODBUS_t *handle, MODBUS_LocalRead readFn) {
 	handle->inputs.reading = readFn;
 }
+INLINE void MODBUS_Inputs_SetBlockReadingFn(MODBUS_t *handle, MODBUS_LocalReadRegs readFn) {
+	handle->inputs.readingRegs = readFn;
+}
 INLINE void MODBUS_Inputs_SetWritingFn(MODBUS_t *handle, MODBUS_LocalWrite writeFn) {
 	handle->inputs.writing = writeFn;
 }
+INLINE void MODBUS_Inputs_SetBlockWritingFn(MODBUS_t *handle, MODBUS_LocalWriteRegs writeFn) {
+	handle->inputs.writingRegs = writeFn;
+}
+INLINE void MODBUS_Inputs_SetMaskWritingFn(MODBUS_t *handle, MODBUS_LocalMaskWrite maskFn) {
+	handle->inputs.writingMask = maskFn;
+}
 INLINE void MODBUS_Inputs_SetRemoteFn(MODBUS_t *handle, MODBUS_RemoteData remoteFn) {
 	handle->inputs.remote = remoteFn;
 }
+INLINE void MODBUS_Inputs_SetBlockRemoteFn(MODBUS_t *handle, MODBUS_RemoteRegs remoteFn) {
+	handle->inputs.remoteRegs = remoteFn;
+}
+void MODBUS_Inputs_SetBank(MODBUS_t *handle, uint16_t *regs, uint16_t baseAddress, uint16_t size) {
+	handle->inputs.bank.pu16Regs = regs;
+	handle->inputs.bank.u16Base = baseAddress;
+	handle->inputs.bank.u16Size = size;
+	handle->inputs.bank.u8IsBits = 0;
+}
 
 /*
  * Gestione RX
  */
 /**
  * @brief Settiamo la flag di ricezione completata.
- * @note Non ha senso farlo in uno stato differente rispetto al Wait dell'RX stessa.
+ * @note In modalità Master non ha senso farlo in uno stato differente rispetto al Wait dell'RX
+ * stessa; lo Slave invece può ricevere una richiesta in qualsiasi momento.
  */
 INLINE void MODBUS_SetRxComplete(MODBUS_t *handle) {
-	if(handle->task == MODBUS_MasterTask_WaitRx)
+	if (handle->uxMode == MODBUS_Mode_Slave || handle->task == MODBUS_MasterTask_WaitRx)
 		handle->u8RxComplete = 1;
 }
 
@@ -842,10 +2268,285 @@ INLINE uint8_t MODBUS_GetRxComplete(MODBUS_t *handle) {
 
 INLINE void MODBUS_SaveByte(MODBUS_t *handle, const uint8_t u8Data) {
 	RingAdd(handle->pxRxBuff, u8Data);
+#if MODBUS_STREAMING_CRC
+	handle->u16RxCRC = MODBUS_CRC_UpdateByte(handle->u16RxCRC, u8Data);
+#endif
+}
+
+/**
+ * @brief Consegna alla libreria un blocco di byte ricevuti, ad esempio un buffer riempito dal DMA
+ * allo scadere del receiver-timeout. Può essere chiamata più volte per la stessa frame (ricezione
+ * a pezzi o doppio buffer); la frame si chiude come sempre con MODBUS_SetRxComplete.
+ */
+void MODBUS_ReceiveBlock(MODBUS_t *handle, const uint8_t *data, uint16_t length) {
+	RingAddN(handle->pxRxBuff, data, length);
+#if MODBUS_STREAMING_CRC
+	handle->u16RxCRC = MODBUS_CRC_Update(handle->u16RxCRC, data, length);
+#endif
+}
+
+/**
+ * @brief Numero di byte ricevuti e scartati perché il buffer di ricezione era pieno.
+ * Contatore libero a 16 bit: va confrontato con il valore letto in precedenza.
+ */
+INLINE uint16_t MODBUS_GetRxOverflows(const MODBUS_t *handle) {
+	return RingGetOverflows(handle->pxRxBuff);
+}
+
+INLINE void MODBUS_SetTxAsync(MODBUS_t *handle, uint8_t enable) {
+	handle->u8TxAsync = enable;
+	handle->u8TxBusy = 0;
+}
+
+/**
+ * @brief Notifica di fine trasmissione (es. interrupt di DMA TX completo / UART TC).
+ */
+INLINE void MODBUS_SetTxComplete(MODBUS_t *handle) {
+	handle->u8TxBusy = 0;
+}
+
+INLINE uint8_t MODBUS_GetTxBusy(const MODBUS_t *handle) {
+	return handle->u8TxBusy;
+}
+
+/**
+ * @brief Accoda un comando per il Master: le scritture come urgenti, le letture come normali.
+ * @return 1 se il comando è accodato (o già atteso), 0 se la coda è piena
+ */
+uint8_t MODBUS_QueueCommand(MODBUS_t *handle, sMODBUS_Commmand *cmd) {
+	eMODBUS_Priority priority = MODBUS_Priority_Normal;
+
+	switch (cmd->functionCode) {
+	case FC_WriteSingleCoil:
+	case FC_WriteSingleRegister:
+	case FC_WriteMultipleCoils:
+	case FC_WriteMultipleRegisters:
+	case FC_MaskWriteRegister:
+	case FC_ReadWriteMultipleRegisters:
+		priority = MODBUS_Priority_Urgent;
+		break;
+	default:
+		break;
+	}
+
+	return MODBUS_QueueCommandPriority(handle, cmd, priority);
+}
+
+/**
+ * @brief Accoda un comando per il Master con la priorità indicata. Una lettura identica ad una già
+ * in coda o in corso non viene accodata di nuovo: la risposta attesa aggiorna comunque i dati
+ * di entrambe. Se quella in coda ha una priorità più bassa, viene spostata al nuovo livello.
+ * @return 1 se il comando è accodato (o già atteso), 0 se la coda è piena o la priorità non valida
+ */
+uint8_t MODBUS_QueueCommandPriority(MODBUS_t *handle, sMODBUS_Commmand *cmd,
+		eMODBUS_Priority priority) {
+	if (priority >= MODBUS_PRIORITY_LEVELS || !IsValidCommand(cmd))
+		return 0;
+
+	if (IsReadInFlight(handle, cmd))
+		return 1;
+
+	uint8_t queuedLevel = QueuedReadLevel(handle, cmd);
+	if (queuedLevel <= priority)
+		return 1;
+
+	if (!q_push(&handle->commands[priority], cmd))
+		return 0;
+	if (queuedLevel < MODBUS_PRIORITY_LEVELS)
+		DropQueuedRead(handle, queuedLevel, cmd);
+
+	return 1;
+}
+
+/**
+ * @brief Imposta la tabella di polling periodico; NULL la disattiva. Le voci vengono verificate
+ * come i comandi accodati, e quelle con periodo nullo non sono ammesse: basta una voce non valida
+ * per scartare la tabella, lasciando attiva quella precedente.
+ * @return 1 se la tabella è attiva (o disattivata con NULL), 0 se contiene voci non valide
+ */
+uint8_t MODBUS_SetPollTable(MODBUS_t *handle, sMODBUS_PollEntry *table, uint16_t count) {
+	if (table == NULL)
+		count = 0;
+
+	for (uint16_t i = 0; i < count; i++) {
+		if (table[i].u16PeriodMs == 0 || !IsValidCommand(&table[i].cmd))
+			return 0;
+	}
+
+	for (uint16_t i = 0; i < count; i++) {
+		table[i].u32Release = handle->u32TickMs + table[i].u16PhaseMs;
+		table[i].u16Missed = 0;
+	}
+
+	handle->pxPollTable = table;
+	handle->u16PollEntries = count;
+	handle->u32PollMissed = 0;
+	return 1;
+}
+
+INLINE uint32_t MODBUS_GetPollMissed(const MODBUS_t *handle) {
+	return handle->u32PollMissed;
+}
+
+/**
+ * @brief Abilita la cache dei valori letti dal Master, con posto per almeno entries valori
+ * (chiamata di nuovo, sostituisce la cache precedente). Le voci di polling i cui dati sono più
+ * giovani di ttlMs non vengono spedite; con ttlMs = 0 il polling non viene mai saltato.
+ * @return 1 se la cache è attiva, 0 se manca la memoria
+ */
+uint8_t MODBUS_CacheEnable(MODBUS_t *handle, uint16_t entries, uint16_t ttlMs) {
+	hMODBUS_Cache cache = CacheNew(entries);
+	if (cache == NULL)
+		return 0;
+
+	if (handle->pxCache != NULL)
+		CacheDelete(handle->pxCache);
+	handle->pxCache = cache;
+	handle->u16CacheTtlMs = ttlMs;
+
+	return 1;
+}
+
+/**
+ * @brief Abilita il timeout di risposta adattativo per ogni slave, entro [floorMs, ceilingMs].
+ * Chiamata di nuovo, riparte da zero con le stime; con ceilingMs = 0 torna al timeout fisso.
+ * @return 1 se l'impostazione è applicata, 0 se i limiti non sono validi o manca la memoria
+ */
+uint8_t MODBUS_SetAdaptiveTimeout(MODBUS_t *handle, uint16_t floorMs, uint16_t ceilingMs) {
+	if (ceilingMs == 0) {
+		free(handle->pxTiming);
+		handle->pxTiming = NULL;
+		return 1;
+	}
+
+	if (floorMs == 0 || floorMs > ceilingMs || ceilingMs > RTT_MAX_CEILING_ms)
+		return 0;
+
+	sSlaveTiming *timing = calloc(256, sizeof(sSlaveTiming));
+	if (timing == NULL)
+		return 0;
+
+	free(handle->pxTiming);
+	handle->pxTiming = timing;
+	handle->u16TimeoutFloorMs = floorMs;
+	handle->u16TimeoutCeilingMs = ceilingMs;
+
+	return 1;
+}
+
+/**
+ * @brief Timeout con cui il Master attende ora la risposta dello slave.
+ */
+uint16_t MODBUS_GetResponseTimeout(const MODBUS_t *handle, uint8_t slaveID) {
+	return ResponseTimeout(handle, slaveID);
+}
+
+/**
+ * @brief Abilita il backoff degli slave che non rispondono. Chiamata di nuovo, azzera lo stato di
+ * tutti gli slave; con maxFailures = 0 il backoff viene disattivato.
+ * @return 1 se l'impostazione è applicata, 0 se i limiti non sono validi o manca la memoria
+ */
+uint8_t MODBUS_SetSlaveBackoff(MODBUS_t *handle, uint8_t maxFailures, uint16_t minMs,
+		uint16_t maxMs) {
+	if (maxFailures == 0) {
+		free(handle->pxHealth);
+		handle->pxHealth = NULL;
+		return 1;
+	}
+
+	if (minMs == 0 || minMs > maxMs)
+		return 0;
+
+	sSlaveHealth *health = calloc(256, sizeof(sSlaveHealth));
+	if (health == NULL)
+		return 0;
+
+	free(handle->pxHealth);
+	handle->pxHealth = health;
+	handle->u8MaxFailures = maxFailures;
+	handle->u16BackoffMinMs = minMs;
+	handle->u16BackoffMaxMs = maxMs;
+
+	return 1;
+}
+
+/**
+ * @brief Contatori e stato di backoff di uno slave.
+ * @return 1 se health è valido, 0 se il backoff non è attivo
+ */
+uint8_t MODBUS_GetSlaveHealth(const MODBUS_t *handle, uint8_t slaveID,
+		sMODBUS_SlaveHealth *health) {
+	if (handle->pxHealth == NULL)
+		return 0;
+
+	*health = handle->pxHealth[slaveID].status;
+	return 1;
+}
+
+/**
+ * @brief Ultimo valore letto dal Master per un indirizzo, senza traffico sul bus.
+ * @param table	Function Code di lettura della tabella (FC_ReadCoilStatus ... FC_ReadInputRegisters)
+ * @return 1 se l'indirizzo è in cache, 0 se non è mai stato letto o la cache non è attiva
+ */
+uint8_t MODBUS_CacheGet(const MODBUS_t *handle, uint8_t slaveID, eMODBUS_FuncCode table,
+		uint16_t address, sMODBUS_CacheValue *value) {
+	if (handle->pxCache == NULL)
+		return 0;
+
+	const sCacheEntry *entry = CacheFind(handle->pxCache, slaveID, table, address);
+	if (entry == NULL)
+		return 0;
+
+	value->u16Value = entry->u16Value;
+	value->u32AgeMs = handle->u32TickMs - entry->u32Timestamp;
+	value->error = entry->u8Error;
+	return 1;
+}
+
+/**
+ * @brief Come MODBUS_CacheGet, con il risultato delle funzioni di lettura dello Slave: chiamata da
+ * una di queste, permette ad uno Slave (RTU o TCP) di rispondere con i dati di un altro
+ * dispositivo. Un indirizzo mai letto, o la cui ultima lettura è fallita, risponde con
+ * Exception_GatewayTarget.
+ */
+sMODBUS_ReadResult MODBUS_CacheLookup(const MODBUS_t *handle, uint8_t slaveID,
+		eMODBUS_FuncCode table, uint16_t address) {
+	sMODBUS_ReadResult result = { .data = 0, .error = Exception_GatewayTarget };
+	sMODBUS_CacheValue value;
+
+	if (MODBUS_CacheGet(handle, slaveID, table, address, &value)
+			&& value.error == Exception_NoException) {
+		result.data = value.u16Value;
+		result.error = Exception_NoException;
+	}
+
+	return result;
+}
+
+/**
+ * @brief Abilita l'unione delle letture allo stesso slave con lo stesso Function Code in una sola
+ * richiesta, se tra le due ci sono al più maxGap indirizzi non richiesti. Gli indirizzi in mezzo
+ * vengono letti anche loro: devono esistere sullo slave, altrimenti la lettura unita fallisce.
+ */
+INLINE void MODBUS_SetReadMerge(MODBUS_t *handle, uint8_t enable, uint16_t maxGap) {
+	handle->u8MergeEnabled = enable;
+	handle->u16MergeGap = maxGap;
+}
+
+/**
+ * @brief Abilita l'unione delle scritture singole (FC5/FC6) a indirizzi consecutivi in una sola
+ * scrittura multipla (FC15/FC16). Le scritture unite generano un solo evento di fine comando.
+ */
+INLINE void MODBUS_SetWriteCombine(MODBUS_t *handle, uint8_t enable) {
+	handle->u8WriteCombine = enable;
 }
 
-INLINE void MODBUS_QueueCommand(MODBUS_t *handle, sMODBUS_Commmand *cmd) {
-	q_push(&handle->commands, cmd);
+/**
+ * @brief Imposta l'attesa dopo una richiesta broadcast, prima della richiesta successiva:
+ * deve bastare agli slave per eseguire la scrittura. Per default è 100 ms.
+ */
+INLINE void MODBUS_SetTurnaroundDelay(MODBUS_t *handle, uint16_t delayMs) {
+	handle->u16TurnaroundMs = delayMs;
 }
 
 /**
@@ -853,50 +2554,248 @@ INLINE void MODBUS_QueueCommand(MODBUS_t *handle, sMODBUS_Commmand *cmd) {
  * Slave. La funzione non è chiamata direttamente, ma è un metodo interno all'oggetto MODBUS.
  */
 void MODBUS_SlaveTask(MODBUS_t *handle) {
-	if (handle->u8RxComplete != 1)
+	// La risposta precedente è ancora in trasmissione: la sFrame è occupata, riproviamo dopo
+	if (handle->u8RxComplete != 1 || handle->u8TxBusy)
 		return;
 	handle->u8RxComplete = 0;
 
-	sMaster_Frame mFrame;
-	sSlave_Frame sFrame;
-	eMODBUS_Excpt error = ReadMasterFrame(handle, &mFrame);
+	// Richiesta e risposta vivono nell'handle: niente copie né frame sullo stack
+	sMaster_Frame *mFrame = &handle->mFrame;
+	sSlave_Frame *sFrame = &handle->sFrame;
+	eMODBUS_Excpt error = ReadMasterFrame(handle, mFrame);
 
-	if (error == Exception_NoException) {
-		switch (mFrame.u8FuncCode) {
-		case FC_WriteMultipleCoils:
-			sFrame = WriteMultipleCoils(handle, &mFrame);
+	if (error == Exception_NoException)
+		error = ExecuteRequest(handle, mFrame, sFrame);
 
-			if (handle->writeCmpltCallback != 0)
-				handle->writeCmpltCallback();
-			break;
-		case FC_WriteMultipleRegisters:
-			sFrame = WriteMultipleRegisters(handle, &mFrame);
+	// Frame corrotta o non per noi: non si risponde. Al broadcast non si risponde mai,
+	// nemmeno con un'eccezione
+	if (error == Exception_InvalidFrame || mFrame->u8DevID == MODBUS_BROADCAST_ADDRESS)
+		return;
 
-			if (handle->writeCmpltCallback != 0)
-				handle->writeCmpltCallback();
-			break;
+	if (error != Exception_NoException)
+		setupExceptionFrame(mFrame, sFrame, error);
 
-		case FC_ReadCoilStatus:
-		case FC_ReadDiscreteInputs:
-		case FC_ReadHoldingRegisters:
-		case FC_ReadInputRegisters:
-			sFrame = ReadValues(handle, &mFrame);
-			break;
+	FrameSlave_AppendCRC(sFrame);
+	StartTx(handle, &sFrame->raw[0], sFrame->u16Length);
+}
 
-		case FC_WriteSingleCoil:
-		case FC_WriteSingleRegister:
-			sFrame = WriteSingle(handle, &mFrame);
+/**
+ * @brief Esegue una richiesta già estratta dal trasporto (es. Modbus TCP): indirizzo dello slave
+ * seguito dalla PDU, senza CRC. La risposta viene scritta nello stesso formato in response,
+ * che deve poter contenere MODBUS_ADU_MAX_SIZE byte.
+ * L'indirizzo non viene confrontato con quello dell'oggetto: è il trasporto a decidere a chi
+ * inoltrare la richiesta. Usa le stesse funzioni di lettura/scrittura dello Slave RTU.
+ * @return Lunghezza della risposta; 0 se la richiesta non è valida e non si deve rispondere
+ */
+uint16_t MODBUS_ProcessRequest(MODBUS_t *handle, const uint8_t *request, uint16_t length,
+		uint8_t *response) {
+	sMaster_Frame *mFrame = &handle->mFrame;
+	sSlave_Frame *sFrame = &handle->sFrame;
+	eMODBUS_Excpt error = Exception_NoException;
 
-			if (handle->writeCmpltCallback != 0)
-				handle->writeCmpltCallback();
-			break;
+	if (length < 2 || length > MODBUS_ADU_MAX_SIZE)
+		return 0;
+
+	memcpy(&mFrame->raw[0], request, length);
+	mFrame->u16Length = length;
+
+	// Function Code sconosciuto: si risponde con l'eccezione. Lunghezza errata: si scarta
+	uint16_t expected = MasterFrameLength(mFrame);
+	if (expected == 0)
+		error = Exception_IllegalFunc;
+	else if (expected != length)
+		return 0;
+
+	if (error == Exception_NoException)
+		error = ExecuteRequest(handle, mFrame, sFrame);
+
+	if (error == Exception_InvalidFrame)
+		return 0;
+
+	if (error != Exception_NoException)
+		setupExceptionFrame(mFrame, sFrame, error);
+
+	memcpy(response, &sFrame->raw[0], sFrame->u16Length);
+	return sFrame->u16Length;
+}
+
+/**
+ * @brief Estrae il prossimo comando accodato con MODBUS_QueueCommand, secondo la priorità, per i
+ * trasporti che gestiscono da sé la spedizione (Modbus TCP).
+ * @return 1 se è stato estratto un comando, 0 se le code sono vuote
+ */
+uint8_t MODBUS_PopCommand(MODBUS_t *handle, sMODBUS_Commmand *cmd) {
+	return CommandPop(handle, cmd);
+}
+
+/**
+ * @brief Costruisce la richiesta di un comando nel formato di MODBUS_ProcessRequest:
+ * indirizzo dello slave + PDU, senza CRC.
+ * @return Lunghezza della richiesta
+ */
+uint16_t MODBUS_BuildRequest(const sMODBUS_Commmand *cmd, uint8_t *request) {
+	uint16_t field = RequestField(cmd);
+	uint16_t length = MASTER_HEADER_BYTES;
+	const uint16_t *regs = cmd->pvData;
+	uint16_t count = cmd->length;
+	uint8_t bytes;
+
+	request[0] = cmd->slaveID;
+	request[1] = cmd->functionCode;
+	request[2] = cmd->regAddress >> 8;
+	request[3] = cmd->regAddress & 0xff;
+	request[4] = field >> 8;
+	request[5] = field & 0xff;
+
+	switch (cmd->functionCode) {
+	case FC_MaskWriteRegister:
+		request[length++] = cmd->u16OrMask >> 8;
+		request[length++] = cmd->u16OrMask & 0xff;
+		break;
+
+	case FC_WriteMultipleCoils:
+		bytes = (cmd->length + 7) / 8;
+		request[length++] = bytes;
+		memcpy(&request[length], cmd->pvData, bytes);
+		length += bytes;
+		// I bit oltre la quantità richiesta vanno spediti a 0
+		if (cmd->length % 8 != 0)
+			request[length - 1] &= (1 << (cmd->length % 8)) - 1;
+		break;
+
+	case FC_ReadWriteMultipleRegisters:
+		request[length++] = cmd->u16WriteAddress >> 8;
+		request[length++] = cmd->u16WriteAddress & 0xff;
+		request[length++] = cmd->u16WriteLength >> 8;
+		request[length++] = cmd->u16WriteLength & 0xff;
+		count = cmd->u16WriteLength;
+		// fallthrough - i valori seguono come in una FC16
+	case FC_WriteMultipleRegisters:
+		request[length++] = count * 2;
+		for (uint16_t i = 0; i < count; i++) {
+			request[length++] = regs[i] >> 8;
+			request[length++] = regs[i] & 0xff;
 		}
+		break;
+
+	default:
+		break;
+	}
+
+	return length;
+}
+
+/**
+ * @brief Elabora la risposta ad un comando ricevuta da un trasporto diverso dalla seriale
+ * (indirizzo + PDU, senza CRC). I dati sono consegnati con le stesse funzioni remote e gli stessi
+ * eventi del Master RTU.
+ * @return Exception_NoException, l'eccezione riportata dallo slave, oppure
+ * Exception_InvalidFrame se la risposta non corrisponde al comando
+ */
+eMODBUS_Excpt MODBUS_ProcessResponse(MODBUS_t *handle, const sMODBUS_Commmand *cmd,
+		const uint8_t *response, uint16_t length) {
+	sSlave_Frame *sFrame = &handle->sFrame;
+	eMODBUS_Excpt error = Exception_InvalidFrame;
+
+	if (length < SLAVE_HEADER_BYTES || length > MODBUS_ADU_MAX_SIZE) {
+		FIRE_EVENT_1PAR(handle->remoteRxErrorCallback, error);
+		return error;
+	}
+
+	memcpy(&sFrame->raw[0], response, length);
+	sFrame->u16Length = length;
+
+	error = CheckResponse(cmd, sFrame);
+	if (error == Exception_NoException && SlaveFrameLength(sFrame) != length)
+		error = Exception_InvalidFrame;
+	if (error == Exception_NoException)
+		error = DeliverResponse(handle, cmd, sFrame, cmd->regAddress);
+
+	if (error == Exception_NoException) {
+		CacheStoreWrite(handle, cmd);
+		FIRE_EVENT(handle->remoteRxOKCallback);
+	} else {
+		CacheMarkError(handle, cmd, error);
+		FIRE_EVENT_1PAR(handle->remoteRxErrorCallback, error);
+	}
+
+	return error;
+}
+
+/**
+ * @brief Segnala che la risposta ad un comando non è arrivata in tempo (trasporti come Modbus TCP,
+ * che gestiscono da sé i timeout). Lancia lo stesso evento del Master RTU.
+ */
+void MODBUS_ProcessTimeout(MODBUS_t *handle, const sMODBUS_Commmand *cmd) {
+	CacheMarkError(handle, cmd, Exception_GatewayTarget);
+	FIRE_EVENT(handle->rxTimeout);
+}
+
+/**
+ * @brief Registra i comandi in volo di un trasporto esterno (Modbus TCP), così che una lettura
+ * identica ad una di questi non venga accodata di nuovo. NULL toglie la registrazione.
+ */
+void MODBUS_SetInFlightFn(MODBUS_t *handle, MODBUS_InFlight inFlightFn, void *context,
+		uint8_t slots) {
+	handle->inFlight = inFlightFn;
+	handle->inFlightContext = context;
+	handle->u8InFlightSlots = (inFlightFn != NULL) ? slots : 0;
+}
+
+/**
+ * @brief Fa avanzare il tempo dell'oggetto (età della cache, polling, backoff) per i trasporti
+ * che non chiamano MODBUS_MasterTickRxTimer ogni millisecondo, come il client TCP.
+ */
+void MODBUS_AdvanceTime(MODBUS_t *handle, uint32_t elapsedMs) {
+	handle->u32TickMs += elapsedMs;
+}
+
+/**
+ * @brief Il Master non ha transazioni in corso e può spedirne una nuova.
+ */
+INLINE uint8_t MODBUS_MasterIsIdle(const MODBUS_t *handle) {
+	return handle->uxMode == MODBUS_Mode_Master
+			&& handle->task == MODBUS_MasterTask_WaitAndSendCommand && !handle->u8TxBusy;
+}
+
+/**
+ * @brief Spedisce una richiesta già formata (indirizzo + PDU, senza CRC) e consegna la risposta
+ * intera alla callback, senza interpretarla. Ha la precedenza sui comandi accodati, ma non
+ * interrompe una transazione in corso.
+ * @return 1 se la richiesta è partita, 0 se il Master è occupato o la richiesta non è valida
+ */
+uint8_t MODBUS_MasterTransact(MODBUS_t *handle, const uint8_t *request, uint16_t length,
+		MODBUS_RawResponse done, void *context) {
+	if (!MODBUS_MasterIsIdle(handle) || done == NULL || length < 2 || length > MODBUS_ADU_MAX_SIZE)
+		return 0;
+
+	// Slave in backoff: la transazione fallisce subito, senza occupare il bus
+	if (!SlaveMayTransmit(handle, request[0])) {
+		done(context, Exception_GatewayTarget, NULL, 0);
+		return 1;
+	}
+
+	memcpy(&handle->mFrame.raw[0], request, length);
+	handle->mFrame.u16Length = length;
+	FrameMaster_AppendCRC(&handle->mFrame);
+
+	// Servono a riconoscere la risposta
+	handle->lastCmd.slaveID = request[0];
+	handle->lastCmd.functionCode = request[1];
+	handle->rawDone = done;
+	handle->rawContext = context;
+
+	if (request[0] == MODBUS_BROADCAST_ADDRESS) {
+		handle->task = MODBUS_MasterTask_Turnaround;
+		handle->u16RxTimeout = handle->u16TurnaroundMs;
 	} else {
-		sFrame = setupExceptionFrame(&mFrame, error);
+		handle->task = MODBUS_MasterTask_WaitRx;
+		ResponseTimeoutStart(handle, request[0]);
 	}
+	DiscardRx(handle);
+	StartTx(handle, &handle->mFrame.raw[0], handle->mFrame.u16Length);
 
-	if (error != Exception_InvalidFrame)
-		handle->hwDataTx(handle, &sFrame.raw[0], sFrame.u16Length);
+	return 1;
 }
 
 /**
@@ -905,19 +2804,45 @@ void MODBUS_SlaveTask(MODBUS_t *handle) {
  * ma è un metodo interno all'oggetto MODBUS.
  */
 void MODBUS_MasterTask_WaitAndSendCommand(MODBUS_t *handle) {
-	if (q_isEmpty(&handle->commands))
+	if (handle->u8TxBusy)
+		return;
+
+	// Prima i comandi accodati, poi il polling periodico
+	if (!CommandPop(handle, &handle->lastCmd)) {
+		if (!PollSchedule(handle, &handle->lastCmd))
+			return;
+		handle->u8CmdLevel = MODBUS_PRIORITY_LEVELS;
+	}
+
+	// Slave in backoff: il comando fallisce subito, tranne la sonda di ogni intervallo
+	if (!SlaveMayTransmit(handle, handle->lastCmd.slaveID)) {
+		CacheMarkError(handle, &handle->lastCmd, Exception_GatewayTarget);
+		FIRE_EVENT_1PAR(handle->remoteRxErrorCallback, Exception_GatewayTarget);
 		return;
+	}
+
+	handle->u8MergedReads = 0;
+	if (handle->u8MergeEnabled)
+		CoalesceReads(handle);
+	if (handle->u8WriteCombine)
+		CombineWrites(handle);
 
-	q_pop(&handle->commands, &handle->lastCmd);
-	sMaster_Frame mFrame = FrameMaster_FromCommand(&handle->lastCmd);
+	FrameMaster_FromCommand(&handle->lastCmd, &handle->mFrame);
 
 	// Spostato in su per una ragione, ma non ricordo quale... queste due righe devono
 	// stare sopra la trasmissione, se no ci sono errori con la sequenza degli stati.
 	// Mi pare. Non ricordo con precisione.
-	handle->task = MODBUS_MasterTask_WaitRx;
-	handle->u16RxTimeout = RX_TIMEOUT_ms;
+	// Al broadcast non risponde nessuno: si attende solo il tempo di turnaround
+	if (handle->lastCmd.slaveID == MODBUS_BROADCAST_ADDRESS) {
+		handle->task = MODBUS_MasterTask_Turnaround;
+		handle->u16RxTimeout = handle->u16TurnaroundMs;
+	} else {
+		handle->task = MODBUS_MasterTask_WaitRx;
+		ResponseTimeoutStart(handle, handle->lastCmd.slaveID);
+	}
 
-	handle->hwDataTx(handle, &mFrame.raw[0], mFrame.u16Length);
+	DiscardRx(handle);
+	StartTx(handle, &handle->mFrame.raw[0], handle->mFrame.u16Length);
 }
 
 
@@ -928,44 +2853,90 @@ void MODBUS_MasterTask_WaitRx(MODBUS_t *handle) {
 		handle->task = MODBUS_MasterTask_ElaborateRx;
 	}
 
-	// Timeout della ricezione
+	// Timeout della ricezione: i byte arrivati finora non sono più attesi
 	if (handle->u16RxTimeout == 0) {
-		FIRE_EVENT(handle->rxTimeout);
+		DiscardRx(handle);
 		handle->task = MODBUS_MasterTask_WaitAndSendCommand;
+		ResponseTimeLost(handle, handle->lastCmd.slaveID);
+		SlaveFailed(handle, handle->lastCmd.slaveID, 1);
+		if (handle->rawDone != NULL) {
+			FinishRawTransaction(handle, Exception_GatewayTarget, NULL, 0);
+			return;
+		}
+
+		CacheMarkError(handle, &handle->lastCmd, Exception_GatewayTarget);
+		FIRE_EVENT(handle->rxTimeout);
+		return;
+	}
+}
+
+
+/**
+ * Attesa dopo una richiesta broadcast: nessuno slave risponde, quindi allo scadere del turnaround
+ * il comando è concluso con successo. Eventuali byte ricevuti nel frattempo sono disturbi.
+ */
+void MODBUS_MasterTask_Turnaround(MODBUS_t *handle) {
+	if (handle->u8TxBusy || handle->u16RxTimeout != 0)
+		return;
+
+	DiscardRx(handle);
+	handle->task = MODBUS_MasterTask_WaitAndSendCommand;
+
+	if (handle->rawDone != NULL) {
+		FinishRawTransaction(handle, Exception_NoException, NULL, 0);
 		return;
 	}
+
+	FIRE_EVENT(handle->remoteRxOKCallback);
 }
 
 
 void MODBUS_MasterTask_ElaborateRx(MODBUS_t *handle) {
-	sSlave_Frame sFrame;
-	eMODBUS_Excpt error = ReadSlaveFrame(handle, &sFrame);
+	sSlave_Frame *sFrame = &handle->sFrame;
 
-	if (error == Exception_NoException) {
-		sRegister SelectedReg;
-		switch (sFrame.u8FuncCode) {
-		case FC_ReadCoilStatus:
-			SelectedReg = handle->coils;
-			break;
-		case FC_ReadDiscreteInputs:
-			SelectedReg = handle->discretes;
-			break;
-		case FC_ReadHoldingRegisters:
-			SelectedReg = handle->holdings;
-			break;
-		case FC_ReadInputRegisters:
-			SelectedReg = handle->inputs;
-			break;
+	if (handle->rawDone != NULL) {
+		handle->task = MODBUS_MasterTask_WaitAndSendCommand;
+		if (ReadRawFrame(handle, sFrame) == Exception_NoException) {
+			ResponseTimeSample(handle, handle->lastCmd.slaveID);
+			SlaveAnswered(handle, handle->lastCmd.slaveID);
+			FinishRawTransaction(handle, Exception_NoException, &sFrame->raw[0], sFrame->u16Length);
+		} else {
+			SlaveFailed(handle, handle->lastCmd.slaveID, 0);
+			FinishRawTransaction(handle, Exception_GatewayTarget, NULL, 0);
 		}
+		return;
+	}
 
-		for (uint16_t addr = 0; addr < handle->lastCmd.length; addr++) {
-			uint16_t data = SelectedReg.readPayload(&sFrame, addr);
-			SelectedReg.remote(handle->lastCmd.slaveID, handle->lastCmd.regAddress + addr, data);
-		}
+	eMODBUS_Excpt error = ReadSlaveFrame(handle, sFrame);
+	uint8_t answered = 0;
+	if (error == Exception_NoException) {
+		error = CheckResponse(&handle->lastCmd, sFrame);
+		answered = (error != Exception_InvalidFrame);
+	}
+
+	// Risposta dello slave interrogato, anche se è un'eccezione: il tempo è valido e lo slave è vivo
+	if (answered) {
+		ResponseTimeSample(handle, handle->lastCmd.slaveID);
+		SlaveAnswered(handle, handle->lastCmd.slaveID);
+	} else {
+		SlaveFailed(handle, handle->lastCmd.slaveID, 0);
+	}
 
+	// Letture unite: ognuna riceve solo i propri indirizzi
+	if (error == Exception_NoException && handle->u8MergedReads != 0) {
+		for (uint8_t i = 0; i < handle->u8MergedReads && error == Exception_NoException; i++)
+			error = DeliverResponse(handle, &handle->mergedReads[i], sFrame,
+					handle->lastCmd.regAddress);
+	} else if (error == Exception_NoException) {
+		error = DeliverResponse(handle, &handle->lastCmd, sFrame, handle->lastCmd.regAddress);
+	}
+
+	if (error == Exception_NoException) {
+		CacheStoreWrite(handle, &handle->lastCmd);
 		FIRE_EVENT(handle->remoteRxOKCallback);
 
 	} else {
+		CacheMarkError(handle, &handle->lastCmd, error);
 		FIRE_EVENT_1PAR(handle->remoteRxErrorCallback, error);
 	}
 
@@ -973,6 +2944,11 @@ void MODBUS_MasterTask_ElaborateRx(MODBUS_t *handle) {
 }
 
 void MODBUS_MasterTickRxTimer(MODBUS_t *handle) {
-	if (handle->u16RxTimeout != 0 && handle->task == MODBUS_MasterTask_WaitRx)
+	handle->u32TickMs++;
+
+	// Il timeout di risposta (o il turnaround) parte solo quando la richiesta è uscita completamente
+	if (handle->u16RxTimeout != 0 && !handle->u8TxBusy
+			&& (handle->task == MODBUS_MasterTask_WaitRx
+					|| handle->task == MODBUS_MasterTask_Turnaround))
 		handle->u16RxTimeout--;
 }
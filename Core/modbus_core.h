@@ -20,12 +20,24 @@
 
 #include <stdint.h>
 #include "RingBuffer/ringbuffer.h"
-#include "usart.h"
+#include "Core/modbus_port.h"
 
 /**************************************************************************************************
  * 									  OPTIONS FROM DEFINE
  **************************************************************************************************/
 
+/// Se abilitato il CRC viene calcolato byte per byte in MODBUS_SaveByte, durante la ricezione.
+/// Al termine della frame la verifica del CRC si riduce ad un confronto con zero.
+#ifndef MODBUS_STREAMING_CRC
+#define MODBUS_STREAMING_CRC	1
+#endif
+
+/// Richiesta/risposta senza CRC: indirizzo dello slave + PDU (al massimo 253 byte)
+#define MODBUS_ADU_MAX_SIZE		254
+
+/// Indirizzo di broadcast: la richiesta è eseguita da tutti gli slave, nessuno risponde
+#define MODBUS_BROADCAST_ADDRESS	0
+
 /**************************************************************************************************
  * 										SAFETY CHECKS
  **************************************************************************************************/
@@ -47,13 +59,23 @@ typedef enum {
 	FC_WriteSingleCoil = 5,
 	FC_WriteSingleRegister = 6,
 	FC_WriteMultipleCoils = 15,
-	FC_WriteMultipleRegisters = 16
+	FC_WriteMultipleRegisters = 16,
+	FC_MaskWriteRegister = 22,
+	FC_ReadWriteMultipleRegisters = 23
 } eMODBUS_FuncCode;
 
 typedef enum {
 	MODBUS_Mode_Master, MODBUS_Mode_Slave,
 } eMODBUS_Mode;
 
+/// Priorità dei comandi accodati dal Master: ogni livello ha la propria coda
+typedef enum {
+	MODBUS_Priority_Urgent,		///< Comandi dell'operatore (default delle scritture)
+	MODBUS_Priority_Normal,		///< Letture di routine (default delle letture)
+	MODBUS_Priority_Bulk,		///< Traffico di fondo: diagnostica, letture massive
+	MODBUS_PRIORITY_LEVELS
+} eMODBUS_Priority;
+
 typedef enum {
 	// MODBUS compliant
 	Exception_IllegalFunc = 1,
@@ -62,6 +84,8 @@ typedef enum {
 	Exception_DevFailure = 4,
 	Exception_ACK = 5,
 	Exception_Busy = 6,
+	Exception_GatewayPath = 10,		///< Gateway: nessuna linea per l'Unit ID richiesto
+	Exception_GatewayTarget = 11,	///< Gateway: lo slave sulla linea non ha risposto
 
 	// Personali - uso interno della libreria
 	Exception_NoException = 0,
@@ -77,15 +101,56 @@ typedef struct sMODBUS MODBUS_t;
 /**
  * Struttura per il passaggio di comandi alla stack MODBUS in modalità MASTER. <br>
  * Servono per comandare all'oggetto l'invio di dati sul bus; possono essere accodati, permettendo
- * l'esecuzione asincrona di più comandi.
+ * l'esecuzione asincrona di più comandi. <br>
+ * Le scritture singole (FC5/FC6) hanno length = 1 e il valore in u16Value; quelle multiple
+ * (FC15/FC16) puntano ai dati con pvData, che devono restare validi fino alla risposta.
+ * FC23 scrive u16WriteLength registri da pvData e poi legge regAddress/length, consegnati come
+ * una lettura dei holdings.
  */
 typedef struct {
 	eMODBUS_FuncCode functionCode;
 	uint8_t slaveID;
 	uint16_t regAddress;
 	uint16_t length;
+	uint16_t u16Value;		///< Valore da scrivere: FC6, oppure FC5 (0 = OFF, altro = ON);
+							///< FC22: maschera AND
+	const void *pvData;		///< FC15: bitmap impacchettata (LSB = primo bit); FC16/FC23: registri
+							///< nell'endianess della macchina
+	uint16_t u16WriteAddress;	///< FC23: primo registro da scrivere (regAddress/length: lettura)
+	uint16_t u16WriteLength;	///< FC23: numero di registri da scrivere
+	uint16_t u16OrMask;		///< FC22: maschera OR
 } sMODBUS_Commmand;
 
+/**
+ * Voce della tabella di polling del Master. <br>
+ * Il comando viene spedito ogni u16PeriodMs, la prima volta u16PhaseMs dopo MODBUS_SetPollTable:
+ * le voci con lo stesso periodo formano un gruppo, e fasi diverse ne distribuiscono il carico.
+ * Gli ultimi due campi sono gestiti dalla libreria.
+ */
+typedef struct {
+	sMODBUS_Commmand cmd;		///< Comando da spedire
+	uint16_t u16PeriodMs;		///< Periodo di interrogazione
+	uint16_t u16PhaseMs;		///< Ritardo della prima interrogazione
+	uint32_t u32Release;		///< Istante (ms) da cui il comando è di nuovo da spedire
+	uint16_t u16Missed;			///< Periodi saltati perché il bus era occupato
+} sMODBUS_PollEntry;
+
+/// Valore remoto nella cache del Master (MODBUS_CacheGet)
+typedef struct {
+	uint16_t u16Value;			///< Ultimo valore letto correttamente
+	uint32_t u32AgeMs;			///< Millisecondi trascorsi da quella lettura
+	eMODBUS_Excpt error;		///< Esito dell'ultima interrogazione: NoException se riuscita
+} sMODBUS_CacheValue;
+
+/// Stato di uno slave visto dal Master (MODBUS_GetSlaveHealth)
+typedef struct {
+	uint16_t u16Timeouts;		///< Risposte non arrivate in tempo (contatore libero)
+	uint16_t u16FrameErrors;	///< Risposte scartate: CRC errato o non corrispondenti al comando
+	uint16_t u16BackoffMs;		///< Intervallo attuale tra le sonde, se in backoff
+	uint8_t u8Failures;			///< Errori consecutivi, azzerati dalla prima risposta valida
+	uint8_t u8Offline;			///< Slave in backoff: riceve solo una sonda per intervallo
+} sMODBUS_SlaveHealth;
+
 /**
  * Struttura per il passaggio dei dati dall'applicazione verso la libreria. <br>
  * Serve da interfaccia tra le due parti, consentendo di non toccare il codice di libreria.
@@ -106,6 +171,48 @@ typedef sMODBUS_ReadResult (*MODBUS_LocalRead)(const uint16_t);
 /// Interfaccia per la scrittura dei dati nella memoria del dispositivo
 typedef eMODBUS_Excpt (*MODBUS_LocalWrite)(const uint16_t, const uint16_t);
 
+/**
+ * Interfaccia per la lettura di un blocco contiguo di registri dalla memoria del dispositivo.
+ * @param uint16_t  Indirizzo del primo registro
+ * @param uint16_t  Numero di registri da leggere
+ * @param uint16_t* Buffer di destinazione, con i valori nell'endianess della macchina
+ */
+typedef eMODBUS_Excpt (*MODBUS_LocalReadRegs)(const uint16_t, const uint16_t, uint16_t*);
+
+/**
+ * Interfaccia per la lettura di un blocco contiguo di coils/discretes dalla memoria del dispositivo.
+ * @param uint16_t  Indirizzo del primo bit
+ * @param uint16_t  Numero di bit da leggere
+ * @param uint8_t*  Bitmap di destinazione, impacchettata come nel protocollo (LSB = primo bit).
+ *                  Il buffer arriva azzerato: basta impostare i bit a 1.
+ */
+typedef eMODBUS_Excpt (*MODBUS_LocalReadBits)(const uint16_t, const uint16_t, uint8_t*);
+
+/**
+ * Interfaccia per la scrittura di un blocco contiguo di registri nella memoria del dispositivo.
+ * @param uint16_t        Indirizzo del primo registro
+ * @param uint16_t        Numero di registri da scrivere
+ * @param const uint16_t* Valori già decodificati, nell'endianess della macchina
+ */
+typedef eMODBUS_Excpt (*MODBUS_LocalWriteRegs)(const uint16_t, const uint16_t, const uint16_t*);
+
+/**
+ * Interfaccia per la scrittura di un blocco contiguo di coils nella memoria del dispositivo.
+ * @param uint16_t       Indirizzo del primo bit
+ * @param uint16_t       Numero di bit da scrivere
+ * @param const uint8_t* Bitmap impacchettata come nel protocollo (LSB = primo bit)
+ */
+typedef eMODBUS_Excpt (*MODBUS_LocalWriteBits)(const uint16_t, const uint16_t, const uint8_t*);
+
+/**
+ * Interfaccia per la scrittura con maschera (FC22) di un registro, da eseguire in modo atomico:
+ * valore = (valore AND maschera AND) OR (maschera OR AND NOT maschera AND).
+ * @param uint16_t Indirizzo del registro
+ * @param uint16_t Maschera AND
+ * @param uint16_t Maschera OR
+ */
+typedef eMODBUS_Excpt (*MODBUS_LocalMaskWrite)(const uint16_t, const uint16_t, const uint16_t);
+
 /// Callback eseguita al termine di un evento; verrà chiamata solo se impostata
 typedef void (*MODBUS_Event)(void);
 
@@ -115,6 +222,43 @@ typedef void(*MODBUS_Exception)(eMODBUS_Excpt);
 /// Callback eseguita dopo aver ricevuto una frame di dati da remoto; chiamata in modalità Master
 typedef void (*MODBUS_RemoteData)(const uint8_t, const uint16_t, const uint16_t);
 
+/**
+ * Callback eseguita una sola volta per ogni risposta di lettura registri; chiamata in modalità Master
+ * @param uint8_t         ID dello slave
+ * @param uint16_t        Indirizzo del primo registro
+ * @param uint16_t        Numero di registri
+ * @param const uint16_t* Valori già decodificati, nell'endianess della macchina
+ */
+typedef void (*MODBUS_RemoteRegs)(const uint8_t, const uint16_t, const uint16_t, const uint16_t*);
+
+/**
+ * Callback eseguita una sola volta per ogni risposta di lettura coils/discretes; modalità Master
+ * @param uint8_t        ID dello slave
+ * @param uint16_t       Indirizzo del primo bit
+ * @param uint16_t       Numero di bit
+ * @param const uint8_t* Bitmap impacchettata come nel protocollo (LSB = primo bit)
+ */
+typedef void (*MODBUS_RemoteBits)(const uint8_t, const uint16_t, const uint16_t, const uint8_t*);
+
+/**
+ * Callback eseguita al termine di una transazione "raw" (MODBUS_MasterTransact).
+ * @param void*          Contesto passato all'avvio della transazione
+ * @param eMODBUS_Excpt  Exception_NoException, oppure Exception_GatewayTarget se lo slave non ha
+ *                       risposto o la risposta non era valida
+ * @param uint8_t*       Risposta senza CRC (indirizzo + PDU); NULL in caso di errore
+ * @param uint16_t       Lunghezza della risposta
+ */
+typedef void (*MODBUS_RawResponse)(void*, eMODBUS_Excpt, const uint8_t*, uint16_t);
+
+/**
+ * Comandi in volo di un trasporto che gestisce da sé la spedizione (Modbus TCP), consultati per
+ * non accodare di nuovo una lettura già in attesa di risposta.
+ * @param void*     Contesto passato a MODBUS_SetInFlightFn
+ * @param uint8_t   Slot del trasporto, da 0 al numero di slot indicato
+ * @return Il comando in volo in quello slot, NULL se lo slot è libero
+ */
+typedef const sMODBUS_Commmand* (*MODBUS_InFlight)(void*, uint8_t);
+
 /**
  *  Callback eseguita al momento della spedizione dei dati
  *  @param MODBUS_t* Puntatore all'oggetto MODBUS che ha originato la richiesta di trasmissione
@@ -130,7 +274,7 @@ typedef void (*MODBUS_DataTx)(const MODBUS_t*, const uint8_t *, const uint8_t);
 /**************************************************************************************************
  * 										METODI DELL'ADT
  **************************************************************************************************/
-MODBUS_t* MODBUS_NewHandle(UART_HandleTypeDef *port);
+MODBUS_t* MODBUS_NewHandle(const sMODBUS_Port *port);
 void MODBUS_DeleteHandle(MODBUS_t *handle);
 
 void MODBUS_ExecuteTask(MODBUS_t *handle);
@@ -153,39 +297,182 @@ void MODBUS_SetHwDataTx(MODBUS_t *handle, MODBUS_DataTx hwDataTx);
  */
 uint8_t MODBUS_GetMyAddress(const MODBUS_t *handle);
 eMODBUS_Mode MODBUS_GetMode(const MODBUS_t *handle);
-UART_HandleTypeDef *MODBUS_GetUART(const MODBUS_t *handle);
+const sMODBUS_Port *MODBUS_GetPort(const MODBUS_t *handle);
 
 
 /*
  * FUNZIONE DI GESTIONE DEI VARI REGISTRI
  */
 void MODBUS_Coils_SetReadingFn(MODBUS_t *handle, MODBUS_LocalRead readFn);
+void MODBUS_Coils_SetBlockReadingFn(MODBUS_t *handle, MODBUS_LocalReadBits readFn);
 void MODBUS_Coils_SetWritingFn(MODBUS_t *handle, MODBUS_LocalWrite writeFn);
+void MODBUS_Coils_SetBlockWritingFn(MODBUS_t *handle, MODBUS_LocalWriteBits writeFn);
 void MODBUS_Coils_SetRemoteFn(MODBUS_t *handle, MODBUS_RemoteData remoteFn);
+void MODBUS_Coils_SetBlockRemoteFn(MODBUS_t *handle, MODBUS_RemoteBits remoteFn);
 
 void MODBUS_Discretes_SetReadingFn(MODBUS_t *handle, MODBUS_LocalRead readFn);
+void MODBUS_Discretes_SetBlockReadingFn(MODBUS_t *handle, MODBUS_LocalReadBits readFn);
 void MODBUS_Discretes_SetRemoteFn(MODBUS_t *handle, MODBUS_RemoteData remoteFn);
+void MODBUS_Discretes_SetBlockRemoteFn(MODBUS_t *handle, MODBUS_RemoteBits remoteFn);
 
 void MODBUS_Holdings_SetReadingFn(MODBUS_t *handle, MODBUS_LocalRead readFn);
+void MODBUS_Holdings_SetBlockReadingFn(MODBUS_t *handle, MODBUS_LocalReadRegs readFn);
 void MODBUS_Holdings_SetRemoteFn(MODBUS_t *handle, MODBUS_RemoteData remoteFn);
+void MODBUS_Holdings_SetBlockRemoteFn(MODBUS_t *handle, MODBUS_RemoteRegs remoteFn);
 
 void MODBUS_Inputs_SetReadingFn(MODBUS_t *handle, MODBUS_LocalRead readFn);
+void MODBUS_Inputs_SetBlockReadingFn(MODBUS_t *handle, MODBUS_LocalReadRegs readFn);
 void MODBUS_Inputs_SetWritingFn(MODBUS_t *handle, MODBUS_LocalWrite writeFn);
+void MODBUS_Inputs_SetBlockWritingFn(MODBUS_t *handle, MODBUS_LocalWriteRegs writeFn);
+void MODBUS_Inputs_SetMaskWritingFn(MODBUS_t *handle, MODBUS_LocalMaskWrite maskFn);
 void MODBUS_Inputs_SetRemoteFn(MODBUS_t *handle, MODBUS_RemoteData remoteFn);
+void MODBUS_Inputs_SetBlockRemoteFn(MODBUS_t *handle, MODBUS_RemoteRegs remoteFn);
+
+
+/*
+ * BANCHI DI MEMORIA - array gestiti direttamente dalla libreria, senza callback
+ * I registri sono nell'endianess della macchina; coils e discretes sono bitmap impacchettate
+ * (bit 0 del byte 0 = baseAddress). Le richieste che cadono interamente nel banco sono servite
+ * con copie dirette; quelle fuori dal banco passano ancora dalle funzioni utente.
+ */
+void MODBUS_Coils_SetBank(MODBUS_t *handle, uint8_t *bits, uint16_t baseAddress, uint16_t size);
+void MODBUS_Discretes_SetBank(MODBUS_t *handle, uint8_t *bits, uint16_t baseAddress, uint16_t size);
+void MODBUS_Holdings_SetBank(MODBUS_t *handle, uint16_t *regs, uint16_t baseAddress, uint16_t size);
+void MODBUS_Inputs_SetBank(MODBUS_t *handle, uint16_t *regs, uint16_t baseAddress, uint16_t size);
 
 
 /*
  * HARDWARE e RX
  */
 void MODBUS_SaveByte(MODBUS_t *handle, const uint8_t u8Data);
+void MODBUS_ReceiveBlock(MODBUS_t *handle, const uint8_t *data, uint16_t length);
 void MODBUS_SetRxComplete(MODBUS_t *handle);
 uint8_t MODBUS_GetRxComplete(MODBUS_t *handle);
 void MODBUS_MasterTickRxTimer(MODBUS_t *handle);
+uint16_t MODBUS_GetRxOverflows(const MODBUS_t *handle);
+
+/*
+ * HARDWARE e TX asincrona (DMA)
+ * Con la TX asincrona abilitata la libreria considera la trasmissione in corso dalla chiamata a
+ * hwDataTx fino a MODBUS_SetTxComplete: nel frattempo il buffer passato non viene toccato,
+ * lo Slave non prepara nuove risposte e il Master non fa partire il timeout di risposta.
+ */
+void MODBUS_SetTxAsync(MODBUS_t *handle, uint8_t enable);
+void MODBUS_SetTxComplete(MODBUS_t *handle);
+uint8_t MODBUS_GetTxBusy(const MODBUS_t *handle);
+
+/*
+ * ELABORAZIONE DIRETTA - per trasporti diversi dalla seriale (Modbus TCP)
+ */
+uint16_t MODBUS_ProcessRequest(MODBUS_t *handle, const uint8_t *request, uint16_t length,
+		uint8_t *response);
+uint8_t MODBUS_PopCommand(MODBUS_t *handle, sMODBUS_Commmand *cmd);
+uint16_t MODBUS_BuildRequest(const sMODBUS_Commmand *cmd, uint8_t *request);
+eMODBUS_Excpt MODBUS_ProcessResponse(MODBUS_t *handle, const sMODBUS_Commmand *cmd,
+		const uint8_t *response, uint16_t length);
+void MODBUS_ProcessTimeout(MODBUS_t *handle, const sMODBUS_Commmand *cmd);
+void MODBUS_SetInFlightFn(MODBUS_t *handle, MODBUS_InFlight inFlightFn, void *context,
+		uint8_t slots);
+void MODBUS_AdvanceTime(MODBUS_t *handle, uint32_t elapsedMs);
+
+/*
+ * MASTER - transazioni "raw": una richiesta qualsiasi (indirizzo + PDU, senza CRC) spedita sulla
+ * linea così com'è, con la risposta restituita intera alla callback. Pensata per i gateway.
+ * Ritorna 0 se il Master è occupato con un'altra transazione.
+ */
+uint8_t MODBUS_MasterTransact(MODBUS_t *handle, const uint8_t *request, uint16_t length,
+		MODBUS_RawResponse done, void *context);
+uint8_t MODBUS_MasterIsIdle(const MODBUS_t *handle);
 
 /*
  * MASTER TX - accodamento dei comandi
+ * Ritorna 0 se la coda è piena e il comando non è stato accodato.
+ * Viene spedito prima il comando del livello più urgente; un livello in attesa ottiene comunque
+ * il bus dopo un numero limitato di comandi più urgenti, quindi non resta mai bloccato.
+ * MODBUS_QueueCommand accoda le scritture come urgenti e le letture come normali.
+ */
+uint8_t MODBUS_QueueCommand(MODBUS_t *handle, sMODBUS_Commmand *cmd);
+uint8_t MODBUS_QueueCommandPriority(MODBUS_t *handle, sMODBUS_Commmand *cmd,
+		eMODBUS_Priority priority);
+
+/*
+ * MASTER - polling periodico
+ * A bus libero il Master spedisce prima i comandi accodati, poi la voce della tabella con la
+ * scadenza (fine del periodo corrente) più vicina. Il tempo è dato da MODBUS_MasterTickRxTimer,
+ * da chiamare ogni millisecondo. La tabella resta dell'applicazione e deve restare valida.
+ * Ritorna 0, e la tabella non viene usata, se una voce non sarebbe accettata da
+ * MODBUS_QueueCommand o ha periodo nullo.
+ */
+uint8_t MODBUS_SetPollTable(MODBUS_t *handle, sMODBUS_PollEntry *table, uint16_t count);
+uint32_t MODBUS_GetPollMissed(const MODBUS_t *handle);
+
+/*
+ * MASTER - unione delle letture vicine
+ * Le letture in testa alla coda e le voci di polling da spedire, se allo stesso slave e con lo
+ * stesso Function Code, diventano una sola richiesta (entro 125 registri / 2000 bit); la risposta
+ * viene consegnata alle funzioni remote solo per gli indirizzi richiesti.
+ */
+void MODBUS_SetReadMerge(MODBUS_t *handle, uint8_t enable, uint16_t maxGap);
+
+/*
+ * MASTER - unione delle scritture singole
+ * Le scritture singole in testa alla stessa coda, allo stesso slave e ad indirizzi consecutivi,
+ * partono come una sola FC15 (coils) o FC16 (registri), entro 1968 bit / 123 registri.
+ * Lo slave deve supportare le scritture multiple.
+ */
+void MODBUS_SetWriteCombine(MODBUS_t *handle, uint8_t enable);
+
+/*
+ * MASTER - cache dei valori remoti
+ * Ogni valore consegnato alle funzioni remote viene anche salvato, con l'istante della lettura
+ * (tempo di MODBUS_MasterTickRxTimer, o di MODBUS_AdvanceTime per i trasporti come il client TCP);
+ * una lettura fallita lascia il valore e ne segna l'errore.
+ * MODBUS_CacheLookup ritorna il risultato nel formato delle letture dello Slave, ma ha bisogno
+ * di oggetto, slave e tabella: per servire i dati da uno Slave locale basta una funzione di
+ * lettura nella glue che li fissa.
+ *  ES:
+ *  	sMODBUS_ReadResult readRemoteHoldings(const uint16_t address) {
+ *  		return MODBUS_CacheLookup(remote, 7, FC_ReadHoldingRegisters, address);
+ *  	}
+ *  	MODBUS_Holdings_SetReadingFn(local, readRemoteHoldings);
+ */
+uint8_t MODBUS_CacheEnable(MODBUS_t *handle, uint16_t entries, uint16_t ttlMs);
+uint8_t MODBUS_CacheGet(const MODBUS_t *handle, uint8_t slaveID, eMODBUS_FuncCode table,
+		uint16_t address, sMODBUS_CacheValue *value);
+sMODBUS_ReadResult MODBUS_CacheLookup(const MODBUS_t *handle, uint8_t slaveID,
+		eMODBUS_FuncCode table, uint16_t address);
+
+/*
+ * MASTER - timeout di risposta adattativo
+ * Per ogni slave il Master stima il tempo di risposta (media mobile e deviazione, come il RTO del
+ * TCP) e lo attende per media + 4 * deviazione, entro [floorMs, ceilingMs]; un timeout raddoppia
+ * la deviazione. Finché uno slave non ha mai risposto si attende ceilingMs (al massimo 8000 ms).
+ * Senza, ogni risposta è attesa per 250 ms.
+ */
+uint8_t MODBUS_SetAdaptiveTimeout(MODBUS_t *handle, uint16_t floorMs, uint16_t ceilingMs);
+uint16_t MODBUS_GetResponseTimeout(const MODBUS_t *handle, uint8_t slaveID);
+
+/*
+ * MASTER - stato degli slave
+ * Dopo maxFailures errori consecutivi (timeout o frame non valide) uno slave va in backoff: i suoi
+ * comandi falliscono subito con Exception_GatewayTarget, tranne uno per intervallo che fa da sonda.
+ * L'intervallo parte da minMs e raddoppia ad ogni sonda fallita, fino a maxMs; la prima risposta
+ * valida riporta lo slave in linea. Vale per il Master RTU, transazioni raw comprese.
+ */
+uint8_t MODBUS_SetSlaveBackoff(MODBUS_t *handle, uint8_t maxFailures, uint16_t minMs,
+		uint16_t maxMs);
+uint8_t MODBUS_GetSlaveHealth(const MODBUS_t *handle, uint8_t slaveID,
+		sMODBUS_SlaveHealth *health);
+
+/*
+ * MASTER - broadcast
+ * I comandi a MODBUS_BROADCAST_ADDRESS possono essere solo scritture (FC5, FC6, FC15, FC16, FC22).
+ * Non si attende risposta: dopo la trasmissione il Master aspetta il tempo di turnaround e
+ * lancia l'evento di fine comando. Le transazioni raw in broadcast terminano con
+ * Exception_NoException e nessuna risposta. Lo Slave esegue le scritture in broadcast senza
+ * rispondere.
  */
-void MODBUS_QueueCommand(MODBUS_t *handle, sMODBUS_Commmand *cmd);
+void MODBUS_SetTurnaroundDelay(MODBUS_t *handle, uint16_t delayMs);
 
 
 #endif /* MODBUS_MODBUS_H_ */
@@ -0,0 +1,65 @@
+/*
+ * modbus_crc.h
+ *
+ *  Created on: 16 ott 2026
+ *      Author: fabizani
+ *
+ *  Motore di calcolo del CRC16 MODBUS (polinomio 0xA001 riflesso, valore iniziale 0xFFFF).
+ *  L'algoritmo utilizzato è selezionabile a compile-time tramite MODBUS_CRC_BACKEND, così da
+ *  scegliere il compromesso migliore tra occupazione di flash/RAM e velocità di calcolo:
+ *  - MODBUS_CRC_BITWISE:	nessuna tabella, 8 iterazioni per byte (implementazione storica)
+ *  - MODBUS_CRC_NIBBLE:	tabella da 16 elementi (32 byte di flash), 2 accessi per byte
+ *  - MODBUS_CRC_TABLE:		tabella da 256 elementi (512 byte di flash), 1 accesso per byte
+ *  - MODBUS_CRC_SLICE4:	slice-by-4, tabelle costanti da 2 KiB (la prima è quella di TABLE)
+ *  - MODBUS_CRC_SLICE8:	slice-by-8, tabelle costanti da 4 KiB, il più veloce su host
+ *
+ *  Le versioni slice-by-N sono pensate per le build su host (gateway Linux), dove la memoria non
+ *  è un problema; su MCU conviene TABLE oppure NIBBLE se la flash scarseggia.
+ *  Nessun backend ha stato: le funzioni sono rientranti e si possono chiamare anche da ISR.
+ */
+
+#ifndef CORE_MODBUS_CRC_H_
+#define CORE_MODBUS_CRC_H_
+
+#include <stdint.h>
+
+/**************************************************************************************************
+ * 									  OPTIONS FROM DEFINE
+ **************************************************************************************************/
+#define MODBUS_CRC_BITWISE		0
+#define MODBUS_CRC_NIBBLE		1
+#define MODBUS_CRC_TABLE		2
+#define MODBUS_CRC_SLICE4		3
+#define MODBUS_CRC_SLICE8		4
+
+#ifndef MODBUS_CRC_BACKEND
+#define MODBUS_CRC_BACKEND		MODBUS_CRC_TABLE
+#endif
+
+/// Valore iniziale del registro CRC, come da specifica MODBUS
+#define MODBUS_CRC_INIT			0xFFFF
+
+/**************************************************************************************************
+ * 										SAFETY CHECKS
+ **************************************************************************************************/
+#if (MODBUS_CRC_BACKEND < MODBUS_CRC_BITWISE) || (MODBUS_CRC_BACKEND > MODBUS_CRC_SLICE8)
+#error "MODBUS_CRC_BACKEND non valido: usare uno dei valori MODBUS_CRC_xxx"
+#endif
+
+/**************************************************************************************************
+ * 										METODI PUBBLICI
+ **************************************************************************************************/
+
+// Aggiorna il registro CRC con u16length byte del buffer. Il registro ritornato NON è invertito,
+// quindi può essere passato di nuovo alla funzione per continuare il calcolo su più blocchi.
+uint16_t MODBUS_CRC_Update(uint16_t crc, const uint8_t *buffer, uint16_t u16length);
+
+// Aggiorna il registro CRC con un singolo byte. Pensata per il calcolo "in streaming" durante la
+// ricezione (ISR): una frame corretta, CRC compreso, lascia il registro a zero.
+uint16_t MODBUS_CRC_UpdateByte(uint16_t crc, const uint8_t u8Data);
+
+// Calcola il CRC di un buffer completo. Il valore ritornato ha i byte già invertiti:
+// il byte alto va spedito per primo (CRC Low del protocollo), quello basso per secondo.
+uint16_t calcCRC(const uint8_t *Buffer, uint16_t u16length);
+
+#endif /* CORE_MODBUS_CRC_H_ */
@@ -0,0 +1,211 @@
+/*
+ * modbus_map.c
+ *
+ *  Created on: 16 ott 2026
+ *      Author: fabizani
+ *
+ * Ricerca degli indirizzi nelle tabelle di dispatch e copia dei dati da/verso le variabili
+ * dell'applicazione. Una richiesta può attraversare più intervalli consecutivi della mappa,
+ * purché non ci siano buchi: altrimenti si ritorna Exception_IllegalAddr, come farebbe il
+ * 'default' degli switch della glue.
+ */
+
+#include <Core/modbus_map.h>
+
+/**************************************************************************************************
+ * 										TYPE DEFINITION
+ *************************************************************************************************/
+
+/// Copia di n elementi tra l'intervallo (a partire da offset) e il buffer (a partire da index)
+typedef void (*MapCopy)(const sMODBUS_MapEntry*, uint16_t offset, uint16_t index, uint16_t n,
+		void *buffer);
+
+/**************************************************************************************************
+ *									DICHIARAZIONI PRIVATE
+ *************************************************************************************************/
+static eMODBUS_Excpt Map_Walk(const sMODBUS_Map *map, uint16_t start, uint16_t count,
+		uint8_t access, MapCopy copy, void *buffer);
+
+static void Map_CopyRegsOut(const sMODBUS_MapEntry *entry, uint16_t offset, uint16_t index,
+		uint16_t n, void *buffer);
+static void Map_CopyRegsIn(const sMODBUS_MapEntry *entry, uint16_t offset, uint16_t index,
+		uint16_t n, void *buffer);
+static void Map_CopyBitsOut(const sMODBUS_MapEntry *entry, uint16_t offset, uint16_t index,
+		uint16_t n, void *buffer);
+static void Map_CopyBitsIn(const sMODBUS_MapEntry *entry, uint16_t offset, uint16_t index,
+		uint16_t n, void *buffer);
+
+/**************************************************************************************************
+ * 										FUNZIONI PRIVATE
+ *************************************************************************************************/
+
+/**
+ * Scorre gli intervalli che coprono [start, start + count), verificando permessi e continuità.
+ * Con copy == NULL esegue solo la verifica: le scritture la fanno prima di toccare i dati,
+ * così una richiesta non valida non lascia la memoria scritta a metà.
+ */
+static eMODBUS_Excpt Map_Walk(const sMODBUS_Map *map, uint16_t start, uint16_t count,
+		uint8_t access, MapCopy copy, void *buffer) {
+	const sMODBUS_MapEntry *entry = MODBUS_Map_Find(map, start);
+	const sMODBUS_MapEntry *end = &map->entries[map->u16Count];
+	uint32_t address = start;
+	uint16_t done = 0;
+
+	while (done < count) {
+		// Indirizzo non coperto dall'intervallo corrente: c'è un buco nella mappa
+		if (entry == NULL || entry == end || address < entry->u16Address
+				|| address >= (uint32_t) entry->u16Address + entry->u16Length)
+			return Exception_IllegalAddr;
+
+		if ((entry->u8Access & access) == 0)
+			return Exception_IllegalAddr;
+
+		uint16_t offset = address - entry->u16Address;
+		uint16_t n = entry->u16Length - offset;
+		if (n > count - done)
+			n = count - done;
+
+		if (copy != NULL)
+			copy(entry, offset, done, n, buffer);
+
+		done += n;
+		address += n;
+		entry++;
+	}
+
+	return Exception_NoException;
+}
+
+static void Map_CopyRegsOut(const sMODBUS_MapEntry *entry, uint16_t offset, uint16_t index,
+		uint16_t n, void *buffer) {
+	const uint16_t *src = (const uint16_t*) entry->pvData + offset;
+	uint16_t *dest = (uint16_t*) buffer + index;
+
+	for (uint16_t i = 0; i < n; i++)
+		dest[i] = src[i];
+}
+
+static void Map_CopyRegsIn(const sMODBUS_MapEntry *entry, uint16_t offset, uint16_t index,
+		uint16_t n, void *buffer) {
+	const uint16_t *src = (const uint16_t*) buffer + index;
+	uint16_t *dest = (uint16_t*) entry->pvData + offset;
+
+	for (uint16_t i = 0; i < n; i++)
+		dest[i] = src[i];
+}
+
+static void Map_CopyBitsOut(const sMODBUS_MapEntry *entry, uint16_t offset, uint16_t index,
+		uint16_t n, void *buffer) {
+	const uint8_t *src = (const uint8_t*) entry->pvData + offset;
+	uint8_t *dest = buffer;
+
+	// Il buffer di destinazione arriva azzerato dalla libreria: impostiamo solo i bit a 1
+	for (uint16_t i = 0; i < n; i++) {
+		uint16_t bit = index + i;
+		if (src[i] != 0)
+			dest[bit / 8] |= 1 << (bit % 8);
+	}
+}
+
+static void Map_CopyBitsIn(const sMODBUS_MapEntry *entry, uint16_t offset, uint16_t index,
+		uint16_t n, void *buffer) {
+	const uint8_t *src = buffer;
+	uint8_t *dest = (uint8_t*) entry->pvData + offset;
+
+	for (uint16_t i = 0; i < n; i++) {
+		uint16_t bit = index + i;
+		dest[i] = (src[bit / 8] >> (bit % 8)) & 0x01;
+	}
+}
+
+/**************************************************************************************************
+ * 										METODI PUBBLICI
+ *************************************************************************************************/
+uint8_t MODBUS_Map_Init(sMODBUS_Map *map) {
+	uint8_t dense = 1;
+
+	for (uint16_t i = 0; i < map->u16Count; i++) {
+		const sMODBUS_MapEntry *entry = &map->entries[i];
+
+		// Le voci senza permessi (es. le guardie del template) possono non avere variabili
+		if (entry->u16Length == 0 || (entry->pvData == NULL && entry->u8Access != 0))
+			return 0;
+
+		if ((uint32_t) entry->u16Address + entry->u16Length > 0x10000)
+			return 0;
+
+		if (entry->u16Length != 1)
+			dense = 0;
+
+		if (i == 0)
+			continue;
+
+		// La mappa deve essere scritta in ordine crescente e senza sovrapposizioni,
+		// altrimenti la ricerca binaria non funziona
+		const sMODBUS_MapEntry *prev = &map->entries[i - 1];
+		if (entry->u16Address < prev->u16Address + prev->u16Length)
+			return 0;
+
+		if (entry->u16Address != prev->u16Address + 1)
+			dense = 0;
+	}
+
+	map->u8Dense = dense;
+	return 1;
+}
+
+const sMODBUS_MapEntry* MODBUS_Map_Find(const sMODBUS_Map *map, uint16_t address) {
+	if (map->u16Count == 0 || address < map->entries[0].u16Address)
+		return NULL;
+
+	// Mappa densa: un elemento per indirizzo, senza buchi. L'indice si ricava direttamente
+	if (map->u8Dense) {
+		uint16_t index = address - map->entries[0].u16Address;
+		return (index < map->u16Count) ? &map->entries[index] : NULL;
+	}
+
+	// Ricerca binaria dell'ultimo intervallo che parte prima (o esattamente su) dell'indirizzo
+	uint16_t low = 0;
+	uint16_t high = map->u16Count;
+	while (high - low > 1) {
+		uint16_t mid = low + (high - low) / 2;
+		if (map->entries[mid].u16Address <= address)
+			low = mid;
+		else
+			high = mid;
+	}
+
+	const sMODBUS_MapEntry *entry = &map->entries[low];
+	if ((uint32_t) address >= (uint32_t) entry->u16Address + entry->u16Length)
+		return NULL;
+
+	return entry;
+}
+
+eMODBUS_Excpt MODBUS_Map_ReadRegs(const sMODBUS_Map *map, uint16_t start, uint16_t count,
+		uint16_t *dest) {
+	return Map_Walk(map, start, count, MAP_ACCESS_R, Map_CopyRegsOut, dest);
+}
+
+eMODBUS_Excpt MODBUS_Map_WriteRegs(const sMODBUS_Map *map, uint16_t start, uint16_t count,
+		const uint16_t *src) {
+	eMODBUS_Excpt error = Map_Walk(map, start, count, MAP_ACCESS_W, NULL, NULL);
+	if (error != Exception_NoException)
+		return error;
+
+	return Map_Walk(map, start, count, MAP_ACCESS_W, Map_CopyRegsIn, (void*) src);
+}
+
+eMODBUS_Excpt MODBUS_Map_ReadBits(const sMODBUS_Map *map, uint16_t start, uint16_t count,
+		uint8_t *dest) {
+	return Map_Walk(map, start, count, MAP_ACCESS_R, Map_CopyBitsOut, dest);
+}
+
+eMODBUS_Excpt MODBUS_Map_WriteBits(const sMODBUS_Map *map, uint16_t start, uint16_t count,
+		const uint8_t *src) {
+	eMODBUS_Excpt error = Map_Walk(map, start, count, MAP_ACCESS_W, NULL, NULL);
+	if (error != Exception_NoException)
+		return error;
+
+	return Map_Walk(map, start, count, MAP_ACCESS_W, Map_CopyBitsIn, (void*) src);
+}
@@ -0,0 +1,84 @@
+/*
+ * modbus_map.h
+ *
+ *  Created on: 16 ott 2026
+ *      Author: fabizani
+ *
+ *  Tabelle di dispatch degli indirizzi MODBUS, generate dalla mappa (vedi modbus_map_template.h).
+ *  Ogni tabella è un array ordinato di intervalli (indirizzo, lunghezza, puntatore, accesso):
+ *  la ricerca è diretta se la mappa è densa, altrimenti binaria. In questo modo anche mappe
+ *  sparse con migliaia di punti si risolvono in O(log n), senza gli switch scritti a mano.
+ *
+ *  Le funzioni MODBUS_Map_ReadRegs/WriteRegs/ReadBits/WriteBits hanno gli stessi parametri delle
+ *  callback a blocchi della libreria, con in più la mappa: nella glue basta inoltrare la chiamata.
+ */
+
+#ifndef CORE_MODBUS_MAP_H_
+#define CORE_MODBUS_MAP_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <Core/modbus_core.h>
+
+/**************************************************************************************************
+ * 									  OPTIONS FROM DEFINE
+ **************************************************************************************************/
+#define MAP_ACCESS_R		0x01	///< Il punto può essere letto dal Master
+#define MAP_ACCESS_W		0x02	///< Il punto può essere scritto dal Master
+#define MAP_ACCESS_RW		(MAP_ACCESS_R | MAP_ACCESS_W)
+
+/**************************************************************************************************
+ * 										TYPE DECLARATION
+ **************************************************************************************************/
+
+/**
+ * Singolo intervallo della mappa. Il puntatore punta ad un array di u16Length elementi:
+ * uint16_t per i registri, uint8_t (0 / diverso da 0) per coils e discretes.
+ */
+typedef struct {
+	uint16_t u16Address;	///< Indirizzo MODBUS del primo elemento
+	uint16_t u16Length;		///< Numero di elementi dell'intervallo
+	void *pvData;			///< Variabili dell'applicazione associate all'intervallo
+	uint8_t u8Access;		///< Permessi di accesso (MAP_ACCESS_xxx)
+} sMODBUS_MapEntry;
+
+/// Tabella di dispatch: va inizializzata con MODBUS_Map_Init prima dell'uso
+typedef struct {
+	const sMODBUS_MapEntry *entries;	///< Intervalli, ordinati per indirizzo crescente
+	uint16_t u16Count;					///< Numero di intervalli
+	uint8_t u8Dense;					///< Mappa contigua di elementi singoli: accesso diretto
+} sMODBUS_Map;
+
+/*
+ * Macro per generare enum e tabelle dalla stessa definizione X-macro della mappa.
+ * Ogni voce della mappa ha il formato: X(nome, indirizzo, lunghezza, puntatore, accesso)
+ */
+#define MAP_AS_ENUM(name, address, length, pointer, access)		name = (address),
+#define MAP_AS_ENTRY(name, address, length, pointer, access)	{ (address), (length), (pointer), (access) },
+
+/// Dichiara la tabella di dispatch 'table' a partire dalla lista X-macro 'list'
+#define MODBUS_MAP_TABLE(table, list) \
+	static const sMODBUS_MapEntry table##_entries[] = { list(MAP_AS_ENTRY) }; \
+	static sMODBUS_Map table = { table##_entries, sizeof(table##_entries) / sizeof(sMODBUS_MapEntry), 0 }
+
+/**************************************************************************************************
+ * 										METODI PUBBLICI
+ **************************************************************************************************/
+
+// Verifica che gli intervalli siano ordinati e non sovrapposti e sceglie il tipo di ricerca.
+// Ritorna 0 se la mappa non è valida.
+uint8_t MODBUS_Map_Init(sMODBUS_Map *map);
+
+// Ritorna l'intervallo che contiene l'indirizzo, oppure NULL se l'indirizzo non è mappato
+const sMODBUS_MapEntry* MODBUS_Map_Find(const sMODBUS_Map *map, uint16_t address);
+
+eMODBUS_Excpt MODBUS_Map_ReadRegs(const sMODBUS_Map *map, uint16_t start, uint16_t count,
+		uint16_t *dest);
+eMODBUS_Excpt MODBUS_Map_WriteRegs(const sMODBUS_Map *map, uint16_t start, uint16_t count,
+		const uint16_t *src);
+eMODBUS_Excpt MODBUS_Map_ReadBits(const sMODBUS_Map *map, uint16_t start, uint16_t count,
+		uint8_t *dest);
+eMODBUS_Excpt MODBUS_Map_WriteBits(const sMODBUS_Map *map, uint16_t start, uint16_t count,
+		const uint8_t *src);
+
+#endif /* CORE_MODBUS_MAP_H_ */
@@ -17,6 +17,8 @@
 #ifndef MODBUS_MODBUS_MAP_1_0_0_H_
 #define MODBUS_MODBUS_MAP_1_0_0_H_
 
+#include <Core/modbus_map.h>
+
 /* Il formato della enumerazione è il seguente:
  * --- xxxx_yyyy_zzzz ---
  *
@@ -27,6 +29,25 @@
  *
  *
  * Per le zone si aggiunge un sottoblocco prima del nome del dato, per specificare il numero della zona.
+ *
+ * La mappa è scritta una sola volta, come lista X-macro: da questa si generano sia le enum
+ * (qui sotto) sia le tabelle di dispatch della glue (MODBUS_MAP_TABLE in modbus_map.h).
+ * Ogni voce ha il formato:
+ *
+ *     X(nome, indirizzo, lunghezza, variabile, accesso)
+ *
+ * - nome:		nome dell'enum, nel formato descritto sopra
+ * - indirizzo:	indirizzo MODBUS del primo elemento
+ * - lunghezza:	numero di registri/bit consecutivi
+ * - variabile:	puntatore alle variabili dell'applicazione (uint16_t per i registri, uint8_t per i
+ * 				bit). Viene valutato solo nella glue, dove le variabili sono visibili.
+ * - accesso:	MAP_ACCESS_R, MAP_ACCESS_W oppure MAP_ACCESS_RW
+ *
+ * Le voci vanno scritte in ordine di indirizzo crescente e senza sovrapposizioni:
+ * MODBUS_Map_Init lo verifica all'avvio.
+ *
+ * ES:	X(Holdings_Motor_Speed, 100, 1, &motor.speed, MAP_ACCESS_R) \
+ * 		X(Holdings_Motor_Setpoints, 110, 8, &motor.setpoints[0], MAP_ACCESS_RW) \
  */
 
 // NOTA: aderire alla specifica SemVer per il versionamento della mappa!!!
@@ -34,20 +55,44 @@
 #define MAPVERSION_MINOR	0
 #define MAPVERSION_PATCH	0
 
+/// Versione della mappa in un singolo registro (MAJOR.MINOR.PATCH = 8.4.4 bit), sempre allineata
+/// ai define sopra: si può esporre al Master così com'è.
+#define MAPVERSION			((MAPVERSION_MAJOR << 8) | (MAPVERSION_MINOR << 4) | MAPVERSION_PATCH)
+
+/**************************************************************************************************
+ * 										SAFETY CHECKS
+ **************************************************************************************************/
+// Un campo oltre la sua larghezza finirebbe in quello accanto, senza nessun avviso
+#if (MAPVERSION_MAJOR > 255) || (MAPVERSION_MINOR > 15) || (MAPVERSION_PATCH > 15)
+#error "Versione della mappa non rappresentabile in MAPVERSION: MAJOR <= 255, MINOR e PATCH <= 15"
+#endif
+
+#define MAP_COILS(X) \
+	X(Coils_EmptyGuard, 0, 1, NULL, 0) \
+
+#define MAP_DISCRETES(X) \
+	X(Discretes_EmptyGuard, 0, 1, NULL, 0) \
+
+#define MAP_HOLDINGS(X) \
+	X(Holdings_EmptyGuard, 0, 1, NULL, 0) \
+
+#define MAP_INPUTS(X) \
+	X(Inputs_EmptyGuard, 0, 1, NULL, 0) \
+
 enum Map_Coils {
-	Coils_EmptyGuard,
+	MAP_COILS(MAP_AS_ENUM)
 };
 
 enum Map_Discretes {
-	Discretes_EmptyGuard,
+	MAP_DISCRETES(MAP_AS_ENUM)
 };
 
 enum Map_Holdings {
-	Holdings_EmptyGuard,
+	MAP_HOLDINGS(MAP_AS_ENUM)
 };
 
 enum Map_Inputs {
-	Inputs_EmptyGuard,
+	MAP_INPUTS(MAP_AS_ENUM)
 };
 
 #endif /* MODBUS_MODBUS_MAP_1_0_0_H_ */
@@ -0,0 +1,63 @@
+/*
+ * modbus_port.h
+ *
+ *  Created on: 16 ott 2026
+ *      Author: fabizani
+ *
+ *  Interfaccia verso il driver della porta seriale (strategy pattern, come per i registri).
+ *  La libreria non conosce l'hardware: chiama solo le funzioni di questa struttura, passando
+ *  ogni volta il contesto del driver. I backend disponibili sono in Port/:
+ *  - modbus_port_stm32:	UART della HAL di STMCube con receiver-timeout hardware
+ *  - modbus_port_posix:	seriali termios e pseudo-terminali (gateway Linux, test su host)
+ *
+ *  Il driver si occupa solo di muovere i byte: i dati ricevuti vanno consegnati alla libreria con
+ *  MODBUS_SaveByte / MODBUS_ReceiveBlock e la fine frame segnalata con MODBUS_SetRxComplete.
+ */
+
+#ifndef CORE_MODBUS_PORT_H_
+#define CORE_MODBUS_PORT_H_
+
+#include <stdint.h>
+
+/**************************************************************************************************
+ * 										TYPE DECLARATION
+ **************************************************************************************************/
+
+/// Apertura della porta; ritorna 0 se la porta non è utilizzabile
+typedef uint8_t (*MODBUS_PortOpen)(void *context);
+
+/// Chiusura della porta e rilascio delle risorse del driver
+typedef void (*MODBUS_PortClose)(void *context);
+
+/// Silenzio sulla linea, in tempi-bit, dopo il quale la frame ricevuta è considerata completa.
+/// Con 0 il timeout va disattivato.
+typedef void (*MODBUS_PortConfigTimeout)(void *context, uint16_t u16Bits);
+
+/// Trasmissione di una frame. Il buffer resta valido fino alla fine della trasmissione
+/// (vedi MODBUS_SetTxAsync per i driver che trasmettono in DMA/interrupt).
+/// Ritorna 0 se la trasmissione non è potuta partire: la notifica di fine TX non arriverà.
+typedef uint8_t (*MODBUS_PortTransmit)(void *context, const uint8_t *data, uint16_t length);
+
+/// Abilitazione / disabilitazione della ricezione
+typedef void (*MODBUS_PortRxControl)(void *context);
+
+/**
+ * Driver di una porta. Le funzioni non utilizzate possono essere lasciate a NULL,
+ * tranne transmit (a meno di usare MODBUS_SetHwDataTx).
+ */
+typedef struct {
+	void *context;						///< Dati del driver, passati ad ogni funzione
+	MODBUS_PortOpen open;				///< Chiamata da MODBUS_NewHandle
+	MODBUS_PortClose close;				///< Chiamata da MODBUS_DeleteHandle
+	MODBUS_PortConfigTimeout configTimeout;	///< Chiamata ad ogni cambio di modalità
+	MODBUS_PortTransmit transmit;		///< Spedizione delle frame
+	MODBUS_PortRxControl enableRx;		///< Abilita la ricezione
+	MODBUS_PortRxControl disableRx;		///< Disabilita la ricezione
+	MODBUS_PortRxControl lockRx;		///< Sospende il produttore (ISR/DMA) mentre il task
+										///< svuota la frame; NULL se gira nello stesso thread
+	MODBUS_PortRxControl unlockRx;		///< Riprende il produttore sospeso da lockRx
+	uint32_t u32Baudrate;				///< Baudrate della linea, per i tempi del protocollo
+										///< (0 = sconosciuto: tempi fissi per 19200 baud o meno)
+} sMODBUS_Port;
+
+#endif /* CORE_MODBUS_PORT_H_ */
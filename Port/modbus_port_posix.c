@@ -0,0 +1,243 @@
+/*
+ * modbus_port_posix.c
+ *
+ *  Created on: 16 ott 2026
+ *      Author: fabizani
+ */
+
+#define _GNU_SOURCE
+#include <Port/modbus_port_posix.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+/**************************************************************************************************
+ * 										DEFINEs & CONSTs
+ *************************************************************************************************/
+#define POSIX_RX_CHUNK			256		///< Byte letti dalla porta per ogni read()
+#define POSIX_MAX_TICKS			1000	///< Limite ai tick recuperati dopo una lunga pausa
+
+/**************************************************************************************************
+ *									DICHIARAZIONI PRIVATE
+ *************************************************************************************************/
+static int64_t Posix_NowMs(void);
+static speed_t Posix_Speed(uint32_t baudrate);
+
+static uint8_t Posix_Open(void *context);
+static void Posix_Close(void *context);
+static void Posix_ConfigTimeout(void *context, uint16_t u16Bits);
+static uint8_t Posix_Transmit(void *context, const uint8_t *data, uint16_t length);
+static void Posix_EnableRx(void *context);
+static void Posix_DisableRx(void *context);
+
+/**************************************************************************************************
+ * 										FUNZIONI PRIVATE
+ *************************************************************************************************/
+static int64_t Posix_NowMs(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static speed_t Posix_Speed(uint32_t baudrate) {
+	switch (baudrate) {
+	case 1200:		return B1200;
+	case 2400:		return B2400;
+	case 4800:		return B4800;
+	case 9600:		return B9600;
+	case 19200:		return B19200;
+	case 38400:		return B38400;
+	case 57600:		return B57600;
+	case 115200:	return B115200;
+	case 230400:	return B230400;
+	default:		return B0;
+	}
+}
+
+static uint8_t Posix_Open(void *context) {
+	sMODBUS_PortPosix *ctx = context;
+	speed_t speed = Posix_Speed(ctx->u32Baudrate);
+	struct termios tty;
+
+	if (speed == B0)
+		return 0;
+
+	ctx->acPtyName[0] = '\0';
+	if (ctx->pcDevice != NULL) {
+		ctx->fd = open(ctx->pcDevice, O_RDWR | O_NOCTTY | O_NONBLOCK);
+	} else {
+		// Nessun device: creiamo un pty, l'altro capo si apre con MODBUS_PortPosix_GetPtyName
+		ctx->fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+		if (ctx->fd >= 0 && (grantpt(ctx->fd) != 0 || unlockpt(ctx->fd) != 0
+				|| ptsname_r(ctx->fd, ctx->acPtyName, sizeof(ctx->acPtyName)) != 0)) {
+			close(ctx->fd);
+			ctx->fd = -1;
+		}
+	}
+
+	if (ctx->fd < 0)
+		return 0;
+
+	// Linea "raw": nessuna elaborazione dei byte, 8 bit di dati e parità richiesta
+	if (tcgetattr(ctx->fd, &tty) == 0) {
+		cfmakeraw(&tty);
+		cfsetispeed(&tty, speed);
+		cfsetospeed(&tty, speed);
+		tty.c_cflag |= CLOCAL | CREAD;
+		tty.c_cflag &= ~(PARENB | PARODD | CSTOPB);
+		if (ctx->cParity == 'E')
+			tty.c_cflag |= PARENB;
+		else if (ctx->cParity == 'O')
+			tty.c_cflag |= PARENB | PARODD;
+		else
+			tty.c_cflag |= CSTOPB;		// Senza parità la specifica chiede 2 bit di stop
+		tcsetattr(ctx->fd, TCSANOW, &tty);
+	}
+	tcflush(ctx->fd, TCIOFLUSH);
+
+	ctx->u8RxActive = 0;
+	ctx->s64LastTickMs = Posix_NowMs();
+	return 1;
+}
+
+static void Posix_Close(void *context) {
+	sMODBUS_PortPosix *ctx = context;
+
+	if (ctx->fd >= 0)
+		close(ctx->fd);
+	ctx->fd = -1;
+}
+
+static void Posix_ConfigTimeout(void *context, uint16_t u16Bits) {
+	sMODBUS_PortPosix *ctx = context;
+	uint32_t ms = ((uint32_t) u16Bits * 1000 + ctx->u32Baudrate - 1) / ctx->u32Baudrate;
+
+	// 0 disattiva il rilevamento della fine frame (MODBUS_DeleteHandle); altrimenti il poll ha la
+	// risoluzione del millisecondo e non possiamo scendere sotto
+	if (u16Bits == 0)
+		ctx->u16SilenceMs = 0;
+	else
+		ctx->u16SilenceMs = (ms == 0) ? 1 : ms;
+}
+
+static uint8_t Posix_Transmit(void *context, const uint8_t *data, uint16_t length) {
+	sMODBUS_PortPosix *ctx = context;
+	struct pollfd pfd = { .fd = ctx->fd, .events = POLLOUT };
+
+	while (length > 0) {
+		ssize_t written = write(ctx->fd, data, length);
+		if (written > 0) {
+			data += written;
+			length -= written;
+		} else if (written < 0 && (errno == EAGAIN || errno == EINTR)) {
+			poll(&pfd, 1, 100);
+		} else {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+static void Posix_EnableRx(void *context) {
+	sMODBUS_PortPosix *ctx = context;
+
+	ctx->u8RxEnabled = 1;
+}
+
+static void Posix_DisableRx(void *context) {
+	sMODBUS_PortPosix *ctx = context;
+
+	ctx->u8RxEnabled = 0;
+	ctx->u8RxActive = 0;
+}
+
+/**************************************************************************************************
+ * 										METODI PUBBLICI
+ *************************************************************************************************/
+void MODBUS_PortPosix_Init(sMODBUS_Port *port, sMODBUS_PortPosix *ctx, const char *device,
+		uint32_t baudrate, char parity) {
+	memset(ctx, 0, sizeof(sMODBUS_PortPosix));
+	ctx->pcDevice = device;
+	ctx->u32Baudrate = baudrate;
+	ctx->cParity = parity;
+	ctx->fd = -1;
+	ctx->u16SilenceMs = 1;
+
+	port->context = ctx;
+	port->open = Posix_Open;
+	port->close = Posix_Close;
+	port->configTimeout = Posix_ConfigTimeout;
+	port->transmit = Posix_Transmit;
+	port->enableRx = Posix_EnableRx;
+	port->disableRx = Posix_DisableRx;
+	// Byte ricevuti e consegnati da MODBUS_PortPosix_Poll, nello stesso thread del task
+	port->lockRx = NULL;
+	port->unlockRx = NULL;
+	port->u32Baudrate = baudrate;
+}
+
+int MODBUS_PortPosix_Poll(MODBUS_t *handle, int timeoutMs) {
+	sMODBUS_PortPosix *ctx = MODBUS_GetPort(handle)->context;
+	struct pollfd pfd = { .fd = ctx->fd, .events = POLLIN };
+	uint8_t buffer[POSIX_RX_CHUNK];
+	int received = 0;
+	int64_t now = Posix_NowMs();
+
+	// Frame in corso: non aspettiamo oltre il silenzio che la chiude
+	if (ctx->u8RxActive && ctx->u16SilenceMs != 0) {
+		int64_t remaining = ctx->s64LastRxMs + ctx->u16SilenceMs - now;
+		if (remaining < 0)
+			remaining = 0;
+		// timeoutMs negativo: attesa infinita, come per poll()
+		if (timeoutMs < 0 || remaining < timeoutMs)
+			timeoutMs = remaining;
+	}
+
+	int ready = poll(&pfd, 1, timeoutMs);
+	if (ready < 0 && errno != EINTR)
+		return -1;
+	now = Posix_NowMs();
+
+	if (ready > 0 && (pfd.revents & POLLIN)) {
+		ssize_t n = read(ctx->fd, buffer, sizeof(buffer));
+		if (n < 0 && errno != EAGAIN && errno != EINTR)
+			return -1;
+
+		// A ricezione disabilitata i byte vengono letti e scartati
+		if (n > 0 && ctx->u8RxEnabled) {
+			MODBUS_ReceiveBlock(handle, buffer, n);
+			ctx->u8RxActive = 1;
+			ctx->s64LastRxMs = now;
+			received = n;
+		}
+	} else if (ready > 0 && (pfd.revents & (POLLERR | POLLHUP))) {
+		// Pty senza l'altro capo aperto: evitiamo di girare a vuoto
+		usleep(1000);
+	}
+
+	if (ctx->u8RxActive && ctx->u16SilenceMs != 0 && now - ctx->s64LastRxMs >= ctx->u16SilenceMs) {
+		ctx->u8RxActive = 0;
+		MODBUS_SetRxComplete(handle);
+	}
+
+	// Tempo del Master (timeout di risposta e polling): un tick per ogni millisecondo trascorso
+	int64_t ticks = now - ctx->s64LastTickMs;
+	if (ticks > POSIX_MAX_TICKS)
+		ticks = POSIX_MAX_TICKS;
+	for (; ticks > 0; ticks--)
+		MODBUS_MasterTickRxTimer(handle);
+	ctx->s64LastTickMs = now;
+
+	return received;
+}
+
+const char* MODBUS_PortPosix_GetPtyName(const sMODBUS_PortPosix *ctx) {
+	return ctx->acPtyName;
+}
@@ -0,0 +1,70 @@
+/*
+ * modbus_port_posix.h
+ *
+ *  Created on: 16 ott 2026
+ *      Author: fabizani
+ *
+ *  Backend della porta per sistemi POSIX (gateway Linux): seriali configurate con termios oppure,
+ *  senza device, uno pseudo-terminale nuovo (comodo per collegare simulatori e test su host).
+ *
+ *  Non ci sono interrupt: il ciclo dell'applicazione chiama MODBUS_PortPosix_Poll, che legge i byte
+ *  disponibili, chiude la frame dopo il silenzio impostato dalla libreria (in tempi-bit, convertiti
+ *  con il baudrate) e fa avanzare il timeout di risposta del Master. La trasmissione è sincrona.
+ *
+ *  ES:
+ *  	static sMODBUS_PortPosix ctx;
+ *  	static sMODBUS_Port port;
+ *  	MODBUS_PortPosix_Init(&port, &ctx, "/dev/ttyUSB0", 19200, 'E');
+ *  	MODBUS_t *bus = MODBUS_NewHandle(&port);
+ *  	for (;;) {
+ *  		MODBUS_PortPosix_Poll(bus, 10);
+ *  		MODBUS_ExecuteTask(bus);
+ *  	}
+ */
+
+#ifndef PORT_MODBUS_PORT_POSIX_H_
+#define PORT_MODBUS_PORT_POSIX_H_
+
+#include <stdint.h>
+#include <Core/modbus_core.h>
+
+/**************************************************************************************************
+ * 									  OPTIONS FROM DEFINE
+ **************************************************************************************************/
+#define POSIX_PTY_NAME_SIZE		64
+
+/**************************************************************************************************
+ * 										TYPE DECLARATION
+ **************************************************************************************************/
+
+/// Contesto del driver: allocato dall'applicazione, deve vivere quanto l'oggetto MODBUS
+typedef struct {
+	const char *pcDevice;		///< Percorso della seriale; NULL per creare uno pseudo-terminale
+	uint32_t u32Baudrate;		///< Baudrate (anche per i pty: serve a calcolare i tempi)
+	char cParity;				///< 'N', 'E' oppure 'O'
+	int fd;						///< File descriptor della porta aperta, -1 se chiusa
+	char acPtyName[POSIX_PTY_NAME_SIZE];	///< Lato slave del pty, da aprire con l'altro capo
+
+	uint16_t u16SilenceMs;		///< Silenzio di fine frame, in millisecondi (0: disattivato)
+	uint8_t u8RxEnabled;		///< Ricezione abilitata dalla libreria
+	uint8_t u8RxActive;			///< Frame in ricezione: attendiamo il silenzio per chiuderla
+	int64_t s64LastRxMs;		///< Istante dell'ultimo byte ricevuto
+	int64_t s64LastTickMs;		///< Ultimo avanzamento del timeout del Master
+} sMODBUS_PortPosix;
+
+/**************************************************************************************************
+ * 										METODI PUBBLICI
+ **************************************************************************************************/
+
+// Prepara il driver; la porta viene aperta da MODBUS_NewHandle
+void MODBUS_PortPosix_Init(sMODBUS_Port *port, sMODBUS_PortPosix *ctx, const char *device,
+		uint32_t baudrate, char parity);
+
+// Attende al più timeoutMs dati dalla porta e li consegna alla libreria.
+// Ritorna il numero di byte ricevuti, -1 in caso di errore sulla porta.
+int MODBUS_PortPosix_Poll(MODBUS_t *handle, int timeoutMs);
+
+// Nome del lato slave dello pseudo-terminale (stringa vuota se si usa una seriale)
+const char* MODBUS_PortPosix_GetPtyName(const sMODBUS_PortPosix *ctx);
+
+#endif /* PORT_MODBUS_PORT_POSIX_H_ */
@@ -0,0 +1,175 @@
+/*
+ * modbus_port_stm32.c
+ *
+ *  Created on: 16 ott 2026
+ *      Author: fabizani
+ *
+ * Questo codice era in MODBUS_NewHandle / MODBUS_SetMode / MODBUS_DeleteHandle: ora la libreria
+ * lo raggiunge tramite l'interfaccia sMODBUS_Port.
+ */
+
+#include <Port/modbus_port_stm32.h>
+
+/**************************************************************************************************
+ *									DICHIARAZIONI PRIVATE
+ *************************************************************************************************/
+static uint8_t STM32_Open(void *context);
+static void STM32_Close(void *context);
+static void STM32_ConfigTimeout(void *context, uint16_t u16Bits);
+static uint8_t STM32_Transmit(void *context, const uint8_t *data, uint16_t length);
+static void STM32_EnableRx(void *context);
+static void STM32_DisableRx(void *context);
+static void STM32_LockRx(void *context);
+static void STM32_UnlockRx(void *context);
+static void STM32_DeliverDma(MODBUS_t *handle, sMODBUS_PortSTM32 *ctx);
+
+/**************************************************************************************************
+ * 										FUNZIONI PRIVATE
+ *************************************************************************************************/
+static uint8_t STM32_Open(void *context) {
+	sMODBUS_PortSTM32 *ctx = context;
+	UART_HandleTypeDef *huart = ctx->huart;
+
+	// Puliamo eventuali errori pendenti e abilitiamo il receiver-timeout
+	__HAL_UART_FLUSH_DRREGISTER(huart);
+	__HAL_UART_CLEAR_IT(huart, UART_CLEAR_PEF);
+	__HAL_UART_CLEAR_IT(huart, UART_CLEAR_FEF);
+	__HAL_UART_CLEAR_IT(huart, UART_CLEAR_NEF);
+	__HAL_UART_CLEAR_IT(huart, UART_CLEAR_OREF);
+	huart->Instance->CR1 |= USART_CR1_RTOIE;
+	huart->Instance->CR2 |= USART_CR2_RTOEN;
+
+	return 1;
+}
+
+static void STM32_Close(void *context) {
+	sMODBUS_PortSTM32 *ctx = context;
+	UART_HandleTypeDef *huart = ctx->huart;
+
+	huart->Instance->CR1 &= ~USART_CR1_RTOIE;
+	huart->Instance->CR2 &= ~USART_CR2_RTOEN;
+}
+
+static void STM32_ConfigTimeout(void *context, uint16_t u16Bits) {
+	sMODBUS_PortSTM32 *ctx = context;
+
+	ctx->huart->Instance->RTOR = u16Bits;
+}
+
+static uint8_t STM32_Transmit(void *context, const uint8_t *data, uint16_t length) {
+	sMODBUS_PortSTM32 *ctx = context;
+	UART_HandleTypeDef *huart = ctx->huart;
+	HAL_StatusTypeDef status;
+
+	if (huart->hdmatx != NULL)
+		status = HAL_UART_Transmit_DMA(huart, (uint8_t*) data, length);
+	else
+		status = HAL_UART_Transmit_IT(huart, (uint8_t*) data, length);
+
+	// HAL_BUSY / HAL_ERROR: la trasmissione non è partita, HAL_UART_TxCpltCallback non arriverà
+	return status == HAL_OK;
+}
+
+static void STM32_EnableRx(void *context) {
+	sMODBUS_PortSTM32 *ctx = context;
+	UART_HandleTypeDef *huart = ctx->huart;
+
+	if (huart->hdmarx != NULL) {
+		ctx->u16RxRead = 0;
+		HAL_UART_Receive_DMA(huart, ctx->au8RxDma, STM32_RX_DMA_SIZE);
+	} else {
+		__HAL_UART_ENABLE_IT(huart, UART_IT_RXNE);
+	}
+}
+
+static void STM32_DisableRx(void *context) {
+	sMODBUS_PortSTM32 *ctx = context;
+	UART_HandleTypeDef *huart = ctx->huart;
+
+	if (huart->hdmarx != NULL)
+		HAL_UART_AbortReceive(huart);
+	else
+		__HAL_UART_DISABLE_IT(huart, UART_IT_RXNE);
+}
+
+/**
+ * Il produttore dei byte è l'interrupt della UART (RXNE senza DMA, RTO con il DMA): basta
+ * mascherare quelli abilitati. Un byte in arrivo resta nel registro dati, o nel buffer del DMA.
+ */
+static void STM32_LockRx(void *context) {
+	sMODBUS_PortSTM32 *ctx = context;
+	UART_HandleTypeDef *huart = ctx->huart;
+
+	ctx->u32RxIrqLocked = huart->Instance->CR1 & (USART_CR1_RXNEIE | USART_CR1_RTOIE);
+	huart->Instance->CR1 &= ~ctx->u32RxIrqLocked;
+}
+
+static void STM32_UnlockRx(void *context) {
+	sMODBUS_PortSTM32 *ctx = context;
+
+	ctx->huart->Instance->CR1 |= ctx->u32RxIrqLocked;
+}
+
+/**
+ * Consegna alla libreria i byte scritti dal DMA dall'ultima consegna: al più due blocchi,
+ * se la frame ha attraversato la fine del buffer circolare.
+ */
+static void STM32_DeliverDma(MODBUS_t *handle, sMODBUS_PortSTM32 *ctx) {
+	uint16_t write = STM32_RX_DMA_SIZE - __HAL_DMA_GET_COUNTER(ctx->huart->hdmarx);
+	if (write == STM32_RX_DMA_SIZE)
+		write = 0;
+
+	if (write < ctx->u16RxRead) {
+		MODBUS_ReceiveBlock(handle, &ctx->au8RxDma[ctx->u16RxRead],
+				STM32_RX_DMA_SIZE - ctx->u16RxRead);
+		ctx->u16RxRead = 0;
+	}
+
+	MODBUS_ReceiveBlock(handle, &ctx->au8RxDma[ctx->u16RxRead], write - ctx->u16RxRead);
+	ctx->u16RxRead = write;
+}
+
+/**************************************************************************************************
+ * 										METODI PUBBLICI
+ *************************************************************************************************/
+void MODBUS_PortSTM32_Init(sMODBUS_Port *port, sMODBUS_PortSTM32 *ctx, UART_HandleTypeDef *huart) {
+	ctx->huart = huart;
+	ctx->u16RxRead = 0;
+
+	port->context = ctx;
+	port->open = STM32_Open;
+	port->close = STM32_Close;
+	port->configTimeout = STM32_ConfigTimeout;
+	port->transmit = STM32_Transmit;
+	port->enableRx = STM32_EnableRx;
+	port->disableRx = STM32_DisableRx;
+	port->lockRx = STM32_LockRx;
+	port->unlockRx = STM32_UnlockRx;
+	port->u32Baudrate = huart->Init.BaudRate;
+}
+
+void MODBUS_PortSTM32_IRQHandler(MODBUS_t *handle) {
+	sMODBUS_PortSTM32 *ctx = MODBUS_GetPort(handle)->context;
+	UART_HandleTypeDef *huart = ctx->huart;
+
+	// Senza DMA: un interrupt per ogni byte ricevuto
+	if (huart->hdmarx == NULL && __HAL_UART_GET_FLAG(huart, UART_FLAG_RXNE))
+		MODBUS_SaveByte(handle, (uint8_t) huart->Instance->RDR);
+
+	// Silenzio sulla linea per il tempo impostato in RTOR: la frame è completa
+	if (__HAL_UART_GET_FLAG(huart, UART_FLAG_RTOF)) {
+		__HAL_UART_CLEAR_FLAG(huart, UART_CLEAR_RTOF);
+
+		if (huart->hdmarx != NULL) {
+			// Un errore di linea (rumore, overrun) fa interrompere il DMA alla HAL: la frame è
+			// comunque persa, ripartiamo da un buffer vuoto
+			if (huart->RxState != HAL_UART_STATE_BUSY_RX) {
+				STM32_EnableRx(ctx);
+				return;
+			}
+			STM32_DeliverDma(handle, ctx);
+		}
+
+		MODBUS_SetRxComplete(handle);
+	}
+}
@@ -0,0 +1,63 @@
+/*
+ * modbus_port_stm32.h
+ *
+ *  Created on: 16 ott 2026
+ *      Author: fabizani
+ *
+ *  Backend della porta per le UART della HAL di STMCube dotate di receiver-timeout (RTOR).
+ *  Il timeout hardware chiude la frame: nell'interrupt della UART basta chiamare
+ *  MODBUS_PortSTM32_IRQHandler, che consegna i byte ricevuti e segnala la fine frame.
+ *
+ *  Se la UART ha un DMA in ricezione (hdmarx, da configurare in modalità circolare) i byte
+ *  arrivano nel buffer del contesto senza interrupt: allo scadere del receiver-timeout vengono
+ *  passati alla libreria in un blocco con MODBUS_ReceiveBlock. Senza DMA si usa un interrupt
+ *  RXNE per byte e MODBUS_SaveByte.
+ *
+ *  La trasmissione usa il DMA se la UART ne ha uno associato, altrimenti l'interrupt: in entrambi
+ *  i casi abilitare MODBUS_SetTxAsync e chiamare MODBUS_SetTxComplete da HAL_UART_TxCpltCallback.
+ *
+ *  ES:
+ *  	static sMODBUS_PortSTM32 ctx;
+ *  	static sMODBUS_Port port;
+ *  	MODBUS_PortSTM32_Init(&port, &ctx, &huart2);
+ *  	MODBUS = MODBUS_NewHandle(&port);
+ *  	MODBUS_SetTxAsync(MODBUS, 1);
+ */
+
+#ifndef PORT_MODBUS_PORT_STM32_H_
+#define PORT_MODBUS_PORT_STM32_H_
+
+#include <Core/modbus_core.h>
+#include "usart.h"
+
+/**************************************************************************************************
+ * 									  OPTIONS FROM DEFINE
+ **************************************************************************************************/
+/// Dimensione del buffer circolare del DMA in ricezione: deve contenere almeno una frame intera
+#ifndef STM32_RX_DMA_SIZE
+#define STM32_RX_DMA_SIZE		512
+#endif
+
+/**************************************************************************************************
+ * 										TYPE DECLARATION
+ **************************************************************************************************/
+
+/// Contesto del driver: allocato dall'applicazione, deve vivere quanto l'oggetto MODBUS
+typedef struct {
+	UART_HandleTypeDef *huart;				///< UART della HAL
+	uint8_t au8RxDma[STM32_RX_DMA_SIZE];	///< Buffer circolare riempito dal DMA in ricezione
+	uint16_t u16RxRead;						///< Primo byte del buffer non ancora consegnato
+	uint32_t u32RxIrqLocked;				///< Interrupt di ricezione sospesi da lockRx
+} sMODBUS_PortSTM32;
+
+/**************************************************************************************************
+ * 										METODI PUBBLICI
+ **************************************************************************************************/
+
+// Prepara il driver per la UART indicata; la struttura va poi passata a MODBUS_NewHandle
+void MODBUS_PortSTM32_Init(sMODBUS_Port *port, sMODBUS_PortSTM32 *ctx, UART_HandleTypeDef *huart);
+
+// Da chiamare nell'interrupt della UART (USARTx_IRQHandler)
+void MODBUS_PortSTM32_IRQHandler(MODBUS_t *handle);
+
+#endif /* PORT_MODBUS_PORT_STM32_H_ */
@@ -6,13 +6,19 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include "ringbuffer.h"
 
 /**************************************************************************************************
  * 										DEFINEs & CONSTs
  **************************************************************************************************/
-#define true 1
-#define false 0
+/*
+ * Accesso agli indici condivisi tra produttore e consumatore. Il "release" garantisce che i dati
+ * siano scritti nel buffer prima che l'altro contesto veda l'indice aggiornato; su Cortex-M
+ * single-core si riduce ad una barriera per il compilatore (più una DMB dove serve).
+ */
+#define LOAD_INDEX(x)			__atomic_load_n(&(x), __ATOMIC_ACQUIRE)
+#define STORE_INDEX(x, val)		__atomic_store_n(&(x), (val), __ATOMIC_RELEASE)
 
 /**************************************************************************************************
  * 										TYPE DEFINITION
@@ -21,76 +27,150 @@
 struct sRing {
 	uint8_t *u8Buffer;
 
-	uint16_t u16BufferSize;
-	uint8_t u8start;
-	uint8_t u8end;
-	uint8_t u8available;
-	uint8_t u8overflow;
+	uint16_t u16BufferSize;		///< Potenza di 2
+	uint16_t u16Mask;			///< u16BufferSize - 1
+	uint16_t u16head;			///< Prossima posizione da scrivere, aggiornata solo dal produttore
+	uint16_t u16tail;			///< Prossima posizione da leggere, aggiornata solo dal consumatore
+	uint16_t u16overflows;		///< Byte scartati a buffer pieno, aggiornato solo dal produttore
 };
 
 /**************************************************************************************************
  *									DICHIARAZIONI PRIVATE
  **************************************************************************************************/
+static void RingCopyOut(hRingBuffer buff, uint16_t tail, uint8_t *buffer, uint16_t uNumber);
 
 /**************************************************************************************************
  * 										FUNZIONI PRIVATE
  **************************************************************************************************/
 
+// Copia uNumber byte a partire da tail, in al più due blocchi se i dati passano dalla fine
+static void RingCopyOut(hRingBuffer buff, uint16_t tail, uint8_t *buffer, uint16_t uNumber) {
+	uint16_t start = tail & buff->u16Mask;
+	uint16_t first = buff->u16BufferSize - start;
+
+	if (first > uNumber)
+		first = uNumber;
+
+	memcpy(buffer, &buff->u8Buffer[start], first);
+	memcpy(buffer + first, &buff->u8Buffer[0], uNumber - first);
+}
+
 /**************************************************************************************************
  * 										METODI DELL'ADT
  **************************************************************************************************/
 hRingBuffer RingNew(uint16_t size) {
+	uint32_t realSize = 1;
+
+	if (size > RING_MAX_SIZE)
+		size = RING_MAX_SIZE;
+
+	while (realSize < size)
+		realSize <<= 1;
+
 	hRingBuffer buff = calloc(1, sizeof(struct sRing));
-	buff->u8Buffer = calloc(size, sizeof(uint8_t));
-	buff->u16BufferSize = size;
+	uint8_t *data = calloc(realSize, sizeof(uint8_t));
+	if (buff == NULL || data == NULL) {
+		free(buff);
+		free(data);
+		return NULL;
+	}
+
+	buff->u8Buffer = data;
+	buff->u16BufferSize = realSize;
+	buff->u16Mask = realSize - 1;
 
 	return buff;
 }
 
-void RingAdd(hRingBuffer buff, uint8_t u8Val) {
+void RingDelete(hRingBuffer buff) {
+	free(buff->u8Buffer);
+	free(buff);
+}
+
+uint8_t RingAdd(hRingBuffer buff, uint8_t u8Val) {
+	uint16_t head = buff->u16head;
+
+	if ((uint16_t) (head - LOAD_INDEX(buff->u16tail)) >= buff->u16BufferSize) {
+		buff->u16overflows++;
+		return 0;
+	}
+
+	buff->u8Buffer[head & buff->u16Mask] = u8Val;
+	STORE_INDEX(buff->u16head, (uint16_t) (head + 1));
+
+	return 1;
+}
+
+uint16_t RingAddN(hRingBuffer buff, const uint8_t *data, uint16_t uNumber) {
+	uint16_t head = buff->u16head;
+	uint16_t free = buff->u16BufferSize - (uint16_t) (head - LOAD_INDEX(buff->u16tail));
 
-	buff->u8Buffer[buff->u8end] = u8Val;
-	buff->u8end = (buff->u8end + 1) % buff->u16BufferSize;
-	if (buff->u8available == buff->u16BufferSize) {
-		buff->u8overflow = true;
-		buff->u8start = (buff->u8start + 1) % buff->u16BufferSize;
-	} else {
-		buff->u8overflow = false;
-		buff->u8available++;
+	if (uNumber > free) {
+		buff->u16overflows += uNumber - free;
+		uNumber = free;
 	}
 
+	uint16_t start = head & buff->u16Mask;
+	uint16_t first = buff->u16BufferSize - start;
+	if (first > uNumber)
+		first = uNumber;
+
+	memcpy(&buff->u8Buffer[start], data, first);
+	memcpy(&buff->u8Buffer[0], data + first, uNumber - first);
+	STORE_INDEX(buff->u16head, (uint16_t) (head + uNumber));
+
+	return uNumber;
 }
 
-__attribute__((always_inline))
-inline uint8_t RingGetAllBytes(hRingBuffer buff, uint8_t *buffer) {
-	return RingGetNBytes(buff, buffer, buff->u8available);
+uint16_t RingGetAllBytes(hRingBuffer buff, uint8_t *buffer) {
+	return RingGetNBytes(buff, buffer, buff->u16BufferSize);
 }
 
-uint8_t RingGetNBytes(hRingBuffer buff, uint8_t *buffer, uint8_t uNumber) {
-	uint8_t uCounter;
-	if (buff->u8available == 0 || uNumber == 0)
-		return 0;
-	if (uNumber > buff->u16BufferSize)
+uint16_t RingGetNBytes(hRingBuffer buff, uint8_t *buffer, uint16_t uNumber) {
+	uint16_t tail = buff->u16tail;
+	uint16_t available = LOAD_INDEX(buff->u16head) - tail;
+
+	if (uNumber > available)
+		uNumber = available;
+	if (uNumber == 0)
 		return 0;
 
-	for (uCounter = 0; uCounter < uNumber && uCounter < buff->u8available; uCounter++) {
-		buffer[uCounter] = buff->u8Buffer[buff->u8start];
-		buff->u8start = (buff->u8start + 1) % buff->u16BufferSize;
-	}
-	buff->u8available = buff->u8available - uCounter;
-	buff->u8overflow = false;
-	RingClear(buff);
+	RingCopyOut(buff, tail, buffer, uNumber);
+	STORE_INDEX(buff->u16tail, (uint16_t) (tail + uNumber));
+
+	return uNumber;
+}
+
+uint16_t RingPeekSpan(hRingBuffer buff, const uint8_t **data) {
+	uint16_t tail = buff->u16tail;
+	uint16_t available = LOAD_INDEX(buff->u16head) - tail;
+	uint16_t start = tail & buff->u16Mask;
+	uint16_t contiguous = buff->u16BufferSize - start;
+
+	*data = &buff->u8Buffer[start];
+	return (available < contiguous) ? available : contiguous;
+}
+
+uint16_t RingSkip(hRingBuffer buff, uint16_t uNumber) {
+	uint16_t tail = buff->u16tail;
+	uint16_t available = LOAD_INDEX(buff->u16head) - tail;
+
+	if (uNumber > available)
+		uNumber = available;
+
+	STORE_INDEX(buff->u16tail, (uint16_t) (tail + uNumber));
+	return uNumber;
+}
 
-	return uCounter;
+uint16_t RingCountBytes(hRingBuffer buff) {
+	return (uint16_t) (LOAD_INDEX(buff->u16head) - buff->u16tail);
 }
 
-uint8_t RingCountBytes(hRingBuffer buff) {
-	return buff->u8available;
+uint16_t RingGetOverflows(hRingBuffer buff) {
+	return LOAD_INDEX(buff->u16overflows);
 }
 
 void RingClear(hRingBuffer buff) {
-	buff->u8start = 0;
-	buff->u8end = 0;
-	buff->u8available = 0;
-	buff->u8overflow = false;
+	// Solo la coda: la testa appartiene al produttore, che potrebbe essere in esecuzione
+	STORE_INDEX(buff->u16tail, LOAD_INDEX(buff->u16head));
 }
@@ -3,6 +3,15 @@
  *
  *  Created on: 7 mar 2022
  *      Author: fabizani
+ *
+ *  Ring buffer single-producer / single-consumer: un solo contesto scrive (tipicamente la ISR
+ *  o la callback del DMA) ed un solo contesto legge (il task). In questa configurazione non
+ *  serve disabilitare gli interrupt: il produttore aggiorna solo la testa, il consumatore solo
+ *  la coda. Gli indici sono a 16 bit e "free-running": la dimensione è una potenza di 2 e la
+ *  posizione nel buffer si ottiene con una maschera.
+ *
+ *  Quando il buffer è pieno i nuovi byte vengono scartati e contati (RingGetOverflows), invece
+ *  di sovrascrivere in silenzio quelli più vecchi.
  */
 
 #ifndef RING_BUFFER_RINGBUFFER_H_
@@ -13,6 +22,8 @@
 /**************************************************************************************************
  * 									  OPTIONS FROM DEFINE
  **************************************************************************************************/
+/// Dimensione massima del buffer: con indici a 16 bit la distanza testa-coda deve stare in 15 bit
+#define RING_MAX_SIZE		32768
 
 /**************************************************************************************************
  * 										SAFETY CHECKS
@@ -31,22 +42,44 @@ typedef struct sRing* hRingBuffer;
 /**************************************************************************************************
  * 										METODI DELL'ADT
  **************************************************************************************************/
+// creates a ring buffer of at least size bytes (rounded up to a power of 2, max RING_MAX_SIZE),
+// returns NULL if the memory is not available
 hRingBuffer RingNew(uint16_t size);
+// frees the ring buffer and its data
+void RingDelete(hRingBuffer buff);
 
+/*
+ * Lato produttore (ISR / DMA)
+ */
+// adds a byte to the ring buffer, returns 0 if the buffer is full and the byte was dropped
+uint8_t RingAdd(hRingBuffer buff, uint8_t u8Val);
 
-// adds a byte to the ring buffer
-void RingAdd(hRingBuffer buff, uint8_t u8Val);
+// adds up to uNumber bytes with at most two copies, returns the number of bytes actually added
+uint16_t RingAddN(hRingBuffer buff, const uint8_t *data, uint16_t uNumber);
 
+/*
+ * Lato consumatore (task)
+ */
 // gets all the available bytes into buffer and return the number of bytes read
-uint8_t RingGetAllBytes(hRingBuffer buff, uint8_t *buffer);
+uint16_t RingGetAllBytes(hRingBuffer buff, uint8_t *buffer);
 
 // gets uNumber of bytes from ring buffer, returns the actual number of bytes read
-uint8_t RingGetNBytes(hRingBuffer buff, uint8_t *buffer, uint8_t uNumber);
+uint16_t RingGetNBytes(hRingBuffer buff, uint8_t *buffer, uint16_t uNumber);
+
+// points *data to the oldest byte and returns how many bytes are contiguous from there,
+// without consuming them. Release them with RingSkip once parsed
+uint16_t RingPeekSpan(hRingBuffer buff, const uint8_t **data);
+
+// consumes uNumber bytes without copying them, returns the actual number of bytes skipped
+uint16_t RingSkip(hRingBuffer buff, uint16_t uNumber);
 
 // return the number of available bytes
-uint8_t RingCountBytes(hRingBuffer buff);
+uint16_t RingCountBytes(hRingBuffer buff);
+
+// return the number of bytes dropped because the buffer was full (free-running counter)
+uint16_t RingGetOverflows(hRingBuffer buff);
 
-// flushes the ring buffer
+// flushes the ring buffer (consumer side: drops everything received so far)
 void RingClear(hRingBuffer buff);
 
 #endif /* RING_BUFFER_RINGBUFFER_H_ */
@@ -0,0 +1,44 @@
+/*
+ * modbus_tcp.h
+ *
+ *  Created on: 16 ott 2026
+ *      Author: fabizani
+ *
+ *  Definizioni comuni del trasporto Modbus TCP. Ogni ADU è preceduta dall'header MBAP:
+ *  - Transaction ID (2 byte): copiato dal server nella risposta
+ *  - Protocol ID (2 byte): sempre 0
+ *  - Length (2 byte): byte che seguono, cioè Unit ID + PDU
+ *  - Unit ID (1 byte): indirizzo dello slave, come nelle frame RTU
+ *  Tutti i campi sono Big Endian. Dall'Unit ID in poi la frame è identica a quella RTU senza CRC:
+ *  è il formato di MODBUS_ProcessRequest.
+ */
+
+#ifndef TCP_MODBUS_TCP_H_
+#define TCP_MODBUS_TCP_H_
+
+#include <stdint.h>
+#include <Core/modbus_core.h>
+
+/**************************************************************************************************
+ * 									  OPTIONS FROM DEFINE
+ **************************************************************************************************/
+#define MODBUS_TCP_PORT			502		///< Porta standard del protocollo
+
+#define MBAP_HEADER_SIZE		7		///< Header completo, Unit ID compreso
+#define MBAP_PREFIX_SIZE		6		///< Header senza Unit ID: precede la frame "RTU senza CRC"
+#define MBAP_TRANSACTION		0		///< Offset del Transaction ID
+#define MBAP_PROTOCOL			2		///< Offset del Protocol ID
+#define MBAP_LENGTH				4		///< Offset del campo Length
+#define MBAP_UNIT				6		///< Offset dell'Unit ID
+
+/// Dimensione massima di una ADU TCP: prefisso MBAP + Unit ID + PDU
+#define MODBUS_TCP_ADU_MAX_SIZE	(MBAP_PREFIX_SIZE + MODBUS_ADU_MAX_SIZE)
+
+/// Lettura/scrittura dei campi Big Endian dell'header
+#define MBAP_GET16(buffer, offset)	((uint16_t) (((buffer)[offset] << 8) | (buffer)[(offset) + 1]))
+#define MBAP_PUT16(buffer, offset, value) do { \
+		(buffer)[offset] = (uint8_t) ((value) >> 8); \
+		(buffer)[(offset) + 1] = (uint8_t) (value); \
+	} while (0)
+
+#endif /* TCP_MODBUS_TCP_H_ */
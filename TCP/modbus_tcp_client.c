@@ -0,0 +1,323 @@
+/*
+ * modbus_tcp_client.c
+ *
+ *  Created on: 16 ott 2026
+ *      Author: fabizani
+ *
+ * Le richieste in volo occupano uno slot ciascuna. Il Transaction ID è scelto in modo che
+ * (ID % window) sia l'indice dello slot: la risposta trova il proprio comando senza ricerche,
+ * e il confronto con l'ID completo scarta le risposte arrivate dopo il timeout.
+ */
+
+#define _GNU_SOURCE
+#include <TCP/modbus_tcp_client.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+/**************************************************************************************************
+ * 										DEFINEs & CONSTs
+ *************************************************************************************************/
+#define TCP_CLIENT_RX_BUFFER		4096
+
+/**************************************************************************************************
+ * 										TYPE DEFINITION
+ *************************************************************************************************/
+
+/// Richiesta spedita e in attesa di risposta
+typedef struct {
+	sMODBUS_Commmand cmd;		///< Comando originale, serve a consegnare la risposta
+	int64_t s64Deadline;		///< Istante oltre il quale la risposta è considerata persa
+	uint16_t u16Transaction;	///< Transaction ID assegnato alla richiesta
+	uint8_t u8Used;				///< Slot occupato
+} sTcpPending;
+
+struct sMODBUS_TcpClient {
+	MODBUS_t *handle;			///< Oggetto MODBUS: coda dei comandi, funzioni remote ed eventi
+	int fd;						///< Socket connesso
+	uint8_t u8Window;			///< Massimo numero di richieste in volo
+	uint8_t u8Outstanding;		///< Richieste attualmente in volo
+	uint16_t u16TimeoutMs;		///< Timeout di risposta
+	uint16_t u16NextGen;		///< Contatore per generare Transaction ID sempre diversi
+	int64_t s64LastTick;		///< Istante fino al quale il tempo dell'oggetto MODBUS è avanzato
+	sTcpPending pending[TCP_CLIENT_MAX_WINDOW];
+
+	uint16_t u16RxLength;		///< Byte ricevuti e non ancora elaborati
+	uint16_t u16TxLength;		///< Byte di richiesta accodati
+	uint16_t u16TxSent;			///< Byte di richiesta già spediti
+	uint8_t *tx;				///< window richieste complete di MBAP
+	uint8_t rx[TCP_CLIENT_RX_BUFFER];
+};
+
+/**************************************************************************************************
+ *									DICHIARAZIONI PRIVATE
+ *************************************************************************************************/
+static int64_t TcpClient_NowMs(void);
+static int64_t TcpClient_Tick(hMODBUS_TcpClient client);
+static void TcpClient_FillWindow(hMODBUS_TcpClient client, int64_t now);
+static int TcpClient_Flush(hMODBUS_TcpClient client);
+static int TcpClient_Receive(hMODBUS_TcpClient client);
+static void TcpClient_Expire(hMODBUS_TcpClient client, int64_t now);
+static const sMODBUS_Commmand* TcpClient_InFlight(void *context, uint8_t slot);
+
+/**************************************************************************************************
+ * 										FUNZIONI PRIVATE
+ *************************************************************************************************/
+static int64_t TcpClient_NowMs(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Porta il tempo dell'oggetto MODBUS (età della cache) all'istante attuale, che ritorna
+static int64_t TcpClient_Tick(hMODBUS_TcpClient client) {
+	int64_t now = TcpClient_NowMs();
+
+	MODBUS_AdvanceTime(client->handle, now - client->s64LastTick);
+	client->s64LastTick = now;
+	return now;
+}
+
+// Estrae i comandi accodati finché ci sono slot liberi e li prepara nel buffer di trasmissione
+static void TcpClient_FillWindow(hMODBUS_TcpClient client, int64_t now) {
+	// Spedizione precedente non ancora completata (anche se nessun byte è ancora partito): il
+	// buffer è dimensionato per window richieste, e uno slot scaduto nel frattempo potrebbe
+	// essere riassegnato mentre la sua richiesta è ancora lì. Accodiamo dopo.
+	if (client->u16TxLength != 0)
+		return;
+
+	for (uint8_t slot = 0; slot < client->u8Window; slot++) {
+		sTcpPending *pending = &client->pending[slot];
+		if (pending->u8Used)
+			continue;
+
+		if (!MODBUS_PopCommand(client->handle, &pending->cmd))
+			return;
+
+		// ID % window == slot, con la generazione che cambia ad ogni richiesta
+		uint16_t generation = client->u16NextGen++ % (0x10000 / TCP_CLIENT_MAX_WINDOW);
+		pending->u16Transaction = generation * client->u8Window + slot;
+		pending->s64Deadline = now + client->u16TimeoutMs;
+		pending->u8Used = 1;
+		client->u8Outstanding++;
+
+		uint8_t *request = &client->tx[client->u16TxLength];
+		uint16_t length = MODBUS_BuildRequest(&pending->cmd, &request[MBAP_UNIT]);
+		MBAP_PUT16(request, MBAP_TRANSACTION, pending->u16Transaction);
+		MBAP_PUT16(request, MBAP_PROTOCOL, 0);
+		MBAP_PUT16(request, MBAP_LENGTH, length);
+		client->u16TxLength += MBAP_PREFIX_SIZE + length;
+	}
+}
+
+/**
+ * Spedisce le richieste accodate, tutte con una sola send se il socket le accetta.
+ * @return 0, oppure -1 se la connessione è caduta
+ */
+static int TcpClient_Flush(hMODBUS_TcpClient client) {
+	while (client->u16TxSent < client->u16TxLength) {
+		ssize_t n = send(client->fd, &client->tx[client->u16TxSent],
+				client->u16TxLength - client->u16TxSent, MSG_NOSIGNAL);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return (errno == EAGAIN) ? 0 : -1;
+		}
+		client->u16TxSent += n;
+	}
+
+	client->u16TxLength = 0;
+	client->u16TxSent = 0;
+	return 0;
+}
+
+/**
+ * Legge le risposte disponibili e le consegna al comando corrispondente.
+ * @return Risposte elaborate, -1 se la connessione è caduta o lo stream non è valido
+ */
+static int TcpClient_Receive(hMODBUS_TcpClient client) {
+	ssize_t n = recv(client->fd, &client->rx[client->u16RxLength],
+			TCP_CLIENT_RX_BUFFER - client->u16RxLength, 0);
+	uint16_t consumed = 0;
+	int delivered = 0;
+
+	if (n == 0)
+		return -1;
+	if (n < 0)
+		return (errno == EAGAIN || errno == EINTR) ? 0 : -1;
+	client->u16RxLength += n;
+
+	while (client->u16RxLength - consumed >= MBAP_HEADER_SIZE) {
+		const uint8_t *response = &client->rx[consumed];
+		uint16_t length = MBAP_GET16(response, MBAP_LENGTH);
+
+		if (MBAP_GET16(response, MBAP_PROTOCOL) != 0 || length < 2 || length > MODBUS_ADU_MAX_SIZE)
+			return -1;
+		if (client->u16RxLength - consumed < MBAP_PREFIX_SIZE + length)
+			break;
+
+		// Risposta ad una richiesta scaduta (o mai spedita): ignorata
+		uint16_t transaction = MBAP_GET16(response, MBAP_TRANSACTION);
+		sTcpPending *pending = &client->pending[transaction % client->u8Window];
+		if (pending->u8Used && pending->u16Transaction == transaction) {
+			pending->u8Used = 0;
+			client->u8Outstanding--;
+			MODBUS_ProcessResponse(client->handle, &pending->cmd, &response[MBAP_UNIT], length);
+			delivered++;
+		}
+
+		consumed += MBAP_PREFIX_SIZE + length;
+	}
+
+	client->u16RxLength -= consumed;
+	memmove(&client->rx[0], &client->rx[consumed], client->u16RxLength);
+	return delivered;
+}
+
+// Libera gli slot delle richieste senza risposta entro il timeout
+static void TcpClient_Expire(hMODBUS_TcpClient client, int64_t now) {
+	for (uint8_t slot = 0; slot < client->u8Window && client->u8Outstanding != 0; slot++) {
+		sTcpPending *pending = &client->pending[slot];
+
+		if (pending->u8Used && now >= pending->s64Deadline) {
+			pending->u8Used = 0;
+			client->u8Outstanding--;
+			MODBUS_ProcessTimeout(client->handle, &pending->cmd);
+		}
+	}
+}
+
+// Comando in attesa di risposta nello slot, per la deduplicazione delle letture del core
+static const sMODBUS_Commmand* TcpClient_InFlight(void *context, uint8_t slot) {
+	const sTcpPending *pending = &((hMODBUS_TcpClient) context)->pending[slot];
+
+	return pending->u8Used ? &pending->cmd : NULL;
+}
+
+/**************************************************************************************************
+ * 										METODI DELL'ADT
+ *************************************************************************************************/
+hMODBUS_TcpClient MODBUS_TcpClient_New(MODBUS_t *handle, const char *host, uint16_t port,
+		uint8_t window) {
+	struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+	struct addrinfo *list = NULL;
+	char service[8];
+	int fd = -1;
+
+	if (window == 0 || window > TCP_CLIENT_MAX_WINDOW)
+		return NULL;
+
+	snprintf(service, sizeof(service), "%u", port);
+	if (getaddrinfo(host, service, &hints, &list) != 0)
+		return NULL;
+
+	for (struct addrinfo *ai = list; ai != NULL && fd < 0; ai = ai->ai_next) {
+		fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+		if (fd >= 0 && connect(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+			close(fd);
+			fd = -1;
+		}
+	}
+	freeaddrinfo(list);
+
+	if (fd < 0)
+		return NULL;
+
+	// Connessione stabilita in modo bloccante; da qui in poi non si blocca più
+	int one = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+	hMODBUS_TcpClient client = calloc(1, sizeof(struct sMODBUS_TcpClient));
+	uint8_t *tx = calloc(window, MODBUS_TCP_ADU_MAX_SIZE);
+	if (client == NULL || tx == NULL) {
+		free(client);
+		free(tx);
+		close(fd);
+		return NULL;
+	}
+
+	client->tx = tx;
+	client->handle = handle;
+	client->fd = fd;
+	client->u8Window = window;
+	client->u16TimeoutMs = TCP_CLIENT_TIMEOUT_ms;
+	client->s64LastTick = TcpClient_NowMs();
+	MODBUS_SetInFlightFn(handle, TcpClient_InFlight, client, window);
+
+	return client;
+}
+
+void MODBUS_TcpClient_Delete(hMODBUS_TcpClient client) {
+	MODBUS_SetInFlightFn(client->handle, NULL, NULL, 0);
+	close(client->fd);
+	free(client->tx);
+	free(client);
+}
+
+int MODBUS_TcpClient_Poll(hMODBUS_TcpClient client, int timeoutMs) {
+	int64_t now = TcpClient_Tick(client);
+	int delivered = 0;
+
+	TcpClient_FillWindow(client, now);
+	if (TcpClient_Flush(client) != 0)
+		return -1;
+
+	// Non attendiamo oltre la prima scadenza
+	for (uint8_t slot = 0; slot < client->u8Window; slot++) {
+		const sTcpPending *pending = &client->pending[slot];
+		// timeoutMs negativo: attesa infinita, come per poll()
+		if (pending->u8Used && (timeoutMs < 0 || pending->s64Deadline - now < timeoutMs))
+			timeoutMs = (pending->s64Deadline > now) ? pending->s64Deadline - now : 0;
+	}
+
+	struct pollfd pfd = { .fd = client->fd, .events = POLLIN };
+	if (client->u16TxLength != 0)
+		pfd.events |= POLLOUT;
+
+	int ready = poll(&pfd, 1, timeoutMs);
+	if (ready < 0 && errno != EINTR)
+		return -1;
+
+	// Le risposte vengono salvate in cache con l'istante di arrivo
+	now = TcpClient_Tick(client);
+
+	if (ready > 0) {
+		if (pfd.revents & (POLLERR | POLLHUP))
+			return -1;
+		if ((pfd.revents & POLLOUT) && TcpClient_Flush(client) != 0)
+			return -1;
+		if (pfd.revents & POLLIN) {
+			delivered = TcpClient_Receive(client);
+			if (delivered < 0)
+				return -1;
+		}
+	}
+
+	TcpClient_Expire(client, now);
+
+	// Slot liberati dalle risposte: spediamo subito i comandi successivi
+	TcpClient_FillWindow(client, now);
+	if (TcpClient_Flush(client) != 0)
+		return -1;
+
+	return delivered;
+}
+
+void MODBUS_TcpClient_SetTimeout(hMODBUS_TcpClient client, uint16_t timeoutMs) {
+	client->u16TimeoutMs = timeoutMs;
+}
+
+uint8_t MODBUS_TcpClient_GetOutstanding(const hMODBUS_TcpClient client) {
+	return client->u8Outstanding;
+}
@@ -0,0 +1,62 @@
+/*
+ * modbus_tcp_client.h
+ *
+ *  Created on: 16 ott 2026
+ *      Author: fabizani
+ *
+ *  Client Modbus TCP con richieste in pipeline. I comandi sono accodati come per il Master RTU
+ *  (MODBUS_QueueCommand sull'oggetto MODBUS associato), ma invece di attenderne uno alla volta ne
+ *  vengono spediti fino a 'window' senza aspettare le risposte. Ogni richiesta ha il proprio
+ *  Transaction ID: le risposte possono arrivare in qualsiasi ordine e vengono consegnate con le
+ *  funzioni remote e gli eventi dell'oggetto MODBUS.
+ *  Il tempo dell'oggetto (età della cache) avanza ad ogni MODBUS_TcpClient_Poll: sullo stesso
+ *  oggetto non va chiamato anche MODBUS_MasterTickRxTimer.
+ *
+ *  ES:
+ *  	MODBUS_t *remote = MODBUS_NewHandle(NULL);
+ *  	MODBUS_Holdings_SetRemoteFn(remote, onHoldings);
+ *  	hMODBUS_TcpClient client = MODBUS_TcpClient_New(remote, "192.168.1.10", MODBUS_TCP_PORT, 8);
+ *  	for (;;) {
+ *  		MODBUS_QueueCommand(remote, &cmd);
+ *  		MODBUS_TcpClient_Poll(client, 10);
+ *  	}
+ */
+
+#ifndef TCP_MODBUS_TCP_CLIENT_H_
+#define TCP_MODBUS_TCP_CLIENT_H_
+
+#include <stdint.h>
+#include <TCP/modbus_tcp.h>
+
+/**************************************************************************************************
+ * 									  OPTIONS FROM DEFINE
+ **************************************************************************************************/
+#define TCP_CLIENT_MAX_WINDOW		64		///< Massimo numero di richieste in volo
+#define TCP_CLIENT_TIMEOUT_ms		1000	///< Timeout di risposta di default
+
+/**************************************************************************************************
+ * 										TYPE DECLARATION
+ **************************************************************************************************/
+// Dichiarazione dell'ADT
+typedef struct sMODBUS_TcpClient* hMODBUS_TcpClient;
+
+/**************************************************************************************************
+ * 										METODI DELL'ADT
+ **************************************************************************************************/
+
+// Si connette al server; window è il numero massimo di richieste in volo (1..TCP_CLIENT_MAX_WINDOW).
+// Ritorna NULL se la connessione non riesce.
+hMODBUS_TcpClient MODBUS_TcpClient_New(MODBUS_t *handle, const char *host, uint16_t port,
+		uint8_t window);
+
+// Chiude la connessione e libera la memoria; le richieste in volo vanno perse
+void MODBUS_TcpClient_Delete(hMODBUS_TcpClient client);
+
+// Spedisce i comandi accodati, attende al più timeoutMs le risposte e le consegna.
+// Ritorna il numero di risposte elaborate, -1 se la connessione è caduta.
+int MODBUS_TcpClient_Poll(hMODBUS_TcpClient client, int timeoutMs);
+
+void MODBUS_TcpClient_SetTimeout(hMODBUS_TcpClient client, uint16_t timeoutMs);
+uint8_t MODBUS_TcpClient_GetOutstanding(const hMODBUS_TcpClient client);
+
+#endif /* TCP_MODBUS_TCP_CLIENT_H_ */
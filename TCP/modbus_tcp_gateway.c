@@ -0,0 +1,307 @@
+/*
+ * modbus_tcp_gateway.c
+ *
+ *  Created on: 16 ott 2026
+ *      Author: fabizani
+ *
+ * Le richieste in coda sono in un array di posti preallocato per ogni linea. Quando la linea si
+ * libera si sceglie la richiesta del primo client che segue, in ordine di slot di connessione,
+ * quello servito per ultimo; tra le richieste dello stesso client vince la più vecchia.
+ * La coda è corta (la seriale è lenta), quindi la scansione costa meno di una struttura a liste.
+ *
+ * Una lettura identica ad una già in coda (o in corso) non va sulla linea: occupa comunque un posto,
+ * per ricordare client e Transaction ID, ma punta alla prima ("leader") e ne riceve la risposta.
+ */
+
+#include <TCP/modbus_tcp_gateway.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**************************************************************************************************
+ * 										TYPE DEFINITION
+ *************************************************************************************************/
+
+/// Richiesta di un client in attesa della linea
+typedef struct sGatewayEntry {
+	uint32_t u32Client;			///< Connessione del client (vedi MODBUS_TcpServer_Reply)
+	uint32_t u32Sequence;		///< Ordine di arrivo
+	uint16_t u16Transaction;	///< Transaction ID da restituire
+	uint16_t u16Length;			///< Lunghezza della richiesta
+	uint8_t u8Used;				///< Posto occupato
+	struct sGatewayEntry *leader;	///< Lettura identica già in coda di cui attende la risposta
+	uint8_t request[MODBUS_ADU_MAX_SIZE];	///< Unit ID + PDU
+} sGatewayEntry;
+
+/// Linea seriale RTU
+typedef struct {
+	MODBUS_t *master;			///< Oggetto MODBUS Master della linea
+	struct sMODBUS_TcpGateway *gateway;
+	sGatewayEntry *entries;		///< Posti della coda
+	sGatewayEntry *active;		///< Richiesta in corso sulla linea, NULL se libera
+	uint8_t u8QueueSize;		///< Numero di posti
+	uint8_t u8Queued;			///< Posti occupati, richiesta in corso compresa
+	uint16_t u16LastClient;		///< Slot di connessione servito per ultimo
+} sGatewayLine;
+
+struct sMODBUS_TcpGateway {
+	hMODBUS_TcpServer server;	///< Server TCP verso i client
+	sGatewayLine lines[GATEWAY_MAX_LINES];
+	uint8_t u8Lines;			///< Linee aggiunte
+	uint8_t route[256];			///< Linea associata ad ogni Unit ID, GATEWAY_NO_LINE se nessuna
+	uint32_t u32Sequence;		///< Contatore per l'ordine di arrivo delle richieste
+};
+
+/**************************************************************************************************
+ *									DICHIARAZIONI PRIVATE
+ *************************************************************************************************/
+static uint16_t Gateway_Request(void *context, const sMODBUS_TcpRequest *request,
+		uint8_t *response);
+static uint16_t Gateway_Exception(const uint8_t *request, eMODBUS_Excpt excpt, uint8_t *response);
+static uint8_t Gateway_SameRead(const sGatewayEntry *entry, const sMODBUS_TcpRequest *request);
+static void Gateway_Release(sGatewayLine *line, sGatewayEntry *entry);
+static void Gateway_Dispatch(sGatewayLine *line);
+static void Gateway_Done(void *context, eMODBUS_Excpt error, const uint8_t *response,
+		uint16_t length);
+
+/**************************************************************************************************
+ * 										FUNZIONI PRIVATE
+ *************************************************************************************************/
+
+// Risposta di eccezione costruita dal gateway stesso
+static uint16_t Gateway_Exception(const uint8_t *request, eMODBUS_Excpt excpt, uint8_t *response) {
+	response[0] = request[0];
+	response[1] = 0x80 | request[1];
+	response[2] = excpt;
+
+	return 3;
+}
+
+// La richiesta è una lettura identica a quella del posto: può condividerne la risposta
+static uint8_t Gateway_SameRead(const sGatewayEntry *entry, const sMODBUS_TcpRequest *request) {
+	uint8_t funcCode = request->request[1];
+
+	if (funcCode < FC_ReadCoilStatus || funcCode > FC_ReadInputRegisters)
+		return 0;
+
+	return entry->u16Length == request->u16Length
+			&& memcmp(entry->request, request->request, request->u16Length) == 0;
+}
+
+// Libera un posto; le richieste agganciate passano alla più vecchia di loro, che diventa leader
+static void Gateway_Release(sGatewayLine *line, sGatewayEntry *entry) {
+	sGatewayEntry *heir = NULL;
+
+	entry->u8Used = 0;
+	line->u8Queued--;
+
+	for (uint8_t i = 0; i < line->u8QueueSize; i++) {
+		sGatewayEntry *follower = &line->entries[i];
+		if (follower->u8Used && follower->leader == entry
+				&& (heir == NULL || follower->u32Sequence < heir->u32Sequence))
+			heir = follower;
+	}
+
+	if (heir == NULL)
+		return;
+
+	for (uint8_t i = 0; i < line->u8QueueSize; i++) {
+		sGatewayEntry *follower = &line->entries[i];
+		if (follower->u8Used && follower->leader == entry)
+			follower->leader = (follower == heir) ? NULL : heir;
+	}
+}
+
+/**
+ * Richiesta di un client TCP: viene accodata sulla linea dello slave, oppure rifiutata subito
+ * con un'eccezione.
+ */
+static uint16_t Gateway_Request(void *context, const sMODBUS_TcpRequest *request,
+		uint8_t *response) {
+	hMODBUS_TcpGateway gateway = context;
+	uint8_t lineIndex = gateway->route[request->request[0]];
+
+	if (lineIndex == GATEWAY_NO_LINE)
+		return Gateway_Exception(request->request, Exception_GatewayPath, response);
+
+	sGatewayLine *line = &gateway->lines[lineIndex];
+	sGatewayEntry *slot = NULL;
+	sGatewayEntry *leader = NULL;
+	uint8_t clientQueued = 0;
+
+	for (uint8_t i = 0; i < line->u8QueueSize; i++) {
+		sGatewayEntry *entry = &line->entries[i];
+		if (!entry->u8Used) {
+			slot = entry;
+			continue;
+		}
+
+		if (entry->u32Client == request->u32Client)
+			clientQueued++;
+		if (leader == NULL && entry->leader == NULL && Gateway_SameRead(entry, request))
+			leader = entry;
+	}
+
+	if (slot == NULL || clientQueued >= GATEWAY_CLIENT_QUOTA)
+		return Gateway_Exception(request->request, Exception_Busy, response);
+
+	slot->u32Client = request->u32Client;
+	slot->u32Sequence = gateway->u32Sequence++;
+	slot->u16Transaction = request->u16Transaction;
+	slot->u16Length = request->u16Length;
+	memcpy(slot->request, request->request, request->u16Length);
+	slot->u8Used = 1;
+	slot->leader = leader;
+	line->u8Queued++;
+
+	// Stessa lettura già in coda o in corso: la risposta arriverà insieme alla sua
+	if (leader != NULL)
+		return 0;
+
+	// Linea libera: partiamo subito, la risposta arriverà con MODBUS_TcpServer_Reply
+	Gateway_Dispatch(line);
+	return 0;
+}
+
+// Se la linea è libera avvia la prossima richiesta, scelta a turno tra i client
+static void Gateway_Dispatch(sGatewayLine *line) {
+	hMODBUS_TcpServer server = line->gateway->server;
+	sGatewayEntry *next = NULL;
+	uint16_t bestDistance = 0;
+
+	if (line->active != NULL || line->u8Queued == 0 || !MODBUS_MasterIsIdle(line->master))
+		return;
+
+	for (uint8_t i = 0; i < line->u8QueueSize; i++) {
+		sGatewayEntry *entry = &line->entries[i];
+		if (!entry->u8Used)
+			continue;
+
+		// Il client si è disconnesso: inutile occupare la linea per lui
+		if (!MODBUS_TcpServer_IsConnected(server, entry->u32Client)) {
+			Gateway_Release(line, entry);
+			continue;
+		}
+
+		// Le richieste agganciate non vanno sulla linea
+		if (entry->leader != NULL)
+			continue;
+
+		// Distanza in avanti dallo slot servito per ultimo: il più vicino tocca per primo
+		uint16_t distance = (uint16_t) ((entry->u32Client & 0xFFFF) - line->u16LastClient - 1);
+		if (next == NULL || distance < bestDistance
+				|| (distance == bestDistance && entry->u32Sequence < next->u32Sequence)) {
+			next = entry;
+			bestDistance = distance;
+		}
+	}
+
+	if (next == NULL)
+		return;
+
+	line->active = next;
+	line->u16LastClient = next->u32Client & 0xFFFF;
+	if (!MODBUS_MasterTransact(line->master, next->request, next->u16Length, Gateway_Done, line))
+		line->active = NULL;
+}
+
+// Fine della transazione sulla linea: risposta (o eccezione) ai client e richiesta successiva
+static void Gateway_Done(void *context, eMODBUS_Excpt error, const uint8_t *response,
+		uint16_t length) {
+	sGatewayLine *line = context;
+	sGatewayEntry *entry = line->active;
+	uint8_t exception[3];
+
+	if (error != Exception_NoException) {
+		length = Gateway_Exception(entry->request, error, exception);
+		response = exception;
+	}
+
+	// Broadcast: la linea non ha risposto, e nemmeno il gateway risponde
+	if (length != 0)
+		MODBUS_TcpServer_Reply(line->gateway->server, entry->u32Client, entry->u16Transaction,
+				response, length);
+
+	for (uint8_t i = 0; i < line->u8QueueSize; i++) {
+		sGatewayEntry *follower = &line->entries[i];
+		if (!follower->u8Used || follower->leader != entry)
+			continue;
+
+		MODBUS_TcpServer_Reply(line->gateway->server, follower->u32Client,
+				follower->u16Transaction, response, length);
+		Gateway_Release(line, follower);
+	}
+
+	Gateway_Release(line, entry);
+	line->active = NULL;
+	Gateway_Dispatch(line);
+}
+
+/**************************************************************************************************
+ * 										METODI DELL'ADT
+ *************************************************************************************************/
+hMODBUS_TcpGateway MODBUS_TcpGateway_New(uint16_t port, uint16_t maxClients) {
+	hMODBUS_TcpServer server = MODBUS_TcpServer_New(NULL, port, maxClients);
+	if (server == NULL)
+		return NULL;
+
+	hMODBUS_TcpGateway gateway = calloc(1, sizeof(struct sMODBUS_TcpGateway));
+	if (gateway == NULL) {
+		MODBUS_TcpServer_Delete(server);
+		return NULL;
+	}
+
+	gateway->server = server;
+	memset(gateway->route, GATEWAY_NO_LINE, sizeof(gateway->route));
+	MODBUS_TcpServer_SetRequestFn(server, Gateway_Request, gateway);
+
+	return gateway;
+}
+
+void MODBUS_TcpGateway_Delete(hMODBUS_TcpGateway gateway) {
+	for (uint8_t i = 0; i < gateway->u8Lines; i++)
+		free(gateway->lines[i].entries);
+
+	MODBUS_TcpServer_Delete(gateway->server);
+	free(gateway);
+}
+
+uint8_t MODBUS_TcpGateway_AddLine(hMODBUS_TcpGateway gateway, MODBUS_t *master, uint8_t queueSize) {
+	if (gateway->u8Lines == GATEWAY_MAX_LINES || queueSize == 0)
+		return GATEWAY_NO_LINE;
+
+	sGatewayEntry *entries = calloc(queueSize, sizeof(sGatewayEntry));
+	if (entries == NULL)
+		return GATEWAY_NO_LINE;
+
+	sGatewayLine *line = &gateway->lines[gateway->u8Lines];
+	line->master = master;
+	line->gateway = gateway;
+	line->entries = entries;
+	line->u8QueueSize = queueSize;
+	line->u16LastClient = 0xFFFF;
+
+	return gateway->u8Lines++;
+}
+
+void MODBUS_TcpGateway_Route(hMODBUS_TcpGateway gateway, uint8_t firstUnit, uint8_t lastUnit,
+		uint8_t line) {
+	if (line >= gateway->u8Lines)
+		return;
+
+	for (uint16_t unit = firstUnit; unit <= lastUnit; unit++)
+		gateway->route[unit] = line;
+}
+
+int MODBUS_TcpGateway_Poll(hMODBUS_TcpGateway gateway, int timeoutMs) {
+	int result = MODBUS_TcpServer_Poll(gateway->server, timeoutMs);
+
+	// Linee liberate nel frattempo (es. da comandi propri dell'applicazione)
+	for (uint8_t i = 0; i < gateway->u8Lines; i++)
+		Gateway_Dispatch(&gateway->lines[i]);
+
+	return result;
+}
+
+hMODBUS_TcpServer MODBUS_TcpGateway_GetServer(const hMODBUS_TcpGateway gateway) {
+	return gateway->server;
+}
@@ -0,0 +1,75 @@
+/*
+ * modbus_tcp_gateway.h
+ *
+ *  Created on: 16 ott 2026
+ *      Author: fabizani
+ *
+ *  Gateway Modbus TCP -> RTU. Le richieste dei client TCP vengono smistate, in base all'Unit ID,
+ *  sugli oggetti MODBUS Master delle linee seriali e la risposta dello slave torna al client con
+ *  il Transaction ID originale.
+ *
+ *  Ogni linea ha una coda limitata di richieste in attesa. La linea serve i client a turno
+ *  (round-robin), così un client che spedisce molte richieste non blocca gli altri; inoltre
+ *  nessun client può occupare più di GATEWAY_CLIENT_QUOTA posti della stessa coda.
+ *  Le letture (FC 1-4) identiche ad una già in coda o in corso non occupano la linea: attendono
+ *  la risposta di quella, che viene spedita a tutti i client interessati.
+ *  - Unit ID senza linea:			eccezione 10 (Gateway Path Unavailable)
+ *  - coda piena o quota superata:	eccezione 6 (Busy)
+ *  - slave che non risponde:		eccezione 11 (Gateway Target Device Failed to Respond)
+ *
+ *  Le linee sono normali oggetti MODBUS in modalità Master: l'applicazione continua a gestirne
+ *  porta e task, e può usarle anche per i propri comandi accodati.
+ *
+ *  ES:
+ *  	hMODBUS_TcpGateway gw = MODBUS_TcpGateway_New(MODBUS_TCP_PORT, 64);
+ *  	uint8_t line = MODBUS_TcpGateway_AddLine(gw, rtuMaster, 16);
+ *  	MODBUS_TcpGateway_Route(gw, 1, 32, line);
+ *  	for (;;) {
+ *  		MODBUS_PortPosix_Poll(rtuMaster, 0);
+ *  		MODBUS_ExecuteTask(rtuMaster);
+ *  		MODBUS_TcpGateway_Poll(gw, 1);
+ *  	}
+ */
+
+#ifndef TCP_MODBUS_TCP_GATEWAY_H_
+#define TCP_MODBUS_TCP_GATEWAY_H_
+
+#include <stdint.h>
+#include <TCP/modbus_tcp_server.h>
+
+/**************************************************************************************************
+ * 									  OPTIONS FROM DEFINE
+ **************************************************************************************************/
+#define GATEWAY_MAX_LINES		8		///< Linee seriali gestite da un gateway
+#define GATEWAY_CLIENT_QUOTA	4		///< Richieste in coda per client, su ogni linea
+#define GATEWAY_NO_LINE			0xFF	///< Valore di ritorno di AddLine in caso di errore
+
+/**************************************************************************************************
+ * 										TYPE DECLARATION
+ **************************************************************************************************/
+// Dichiarazione dell'ADT
+typedef struct sMODBUS_TcpGateway* hMODBUS_TcpGateway;
+
+/**************************************************************************************************
+ * 										METODI DELL'ADT
+ **************************************************************************************************/
+
+// Apre il server TCP del gateway. Ritorna NULL in caso di errore.
+hMODBUS_TcpGateway MODBUS_TcpGateway_New(uint16_t port, uint16_t maxClients);
+void MODBUS_TcpGateway_Delete(hMODBUS_TcpGateway gateway);
+
+// Aggiunge una linea RTU con una coda di queueSize richieste. Ritorna l'indice della linea,
+// GATEWAY_NO_LINE se non c'è più posto o manca la memoria per la coda.
+uint8_t MODBUS_TcpGateway_AddLine(hMODBUS_TcpGateway gateway, MODBUS_t *master, uint8_t queueSize);
+
+// Associa gli Unit ID da firstUnit a lastUnit (compresi) alla linea
+void MODBUS_TcpGateway_Route(hMODBUS_TcpGateway gateway, uint8_t firstUnit, uint8_t lastUnit,
+		uint8_t line);
+
+// Gestisce il traffico TCP e avvia le richieste sulle linee libere.
+// Ritorna lo stesso valore di MODBUS_TcpServer_Poll.
+int MODBUS_TcpGateway_Poll(hMODBUS_TcpGateway gateway, int timeoutMs);
+
+hMODBUS_TcpServer MODBUS_TcpGateway_GetServer(const hMODBUS_TcpGateway gateway);
+
+#endif /* TCP_MODBUS_TCP_GATEWAY_H_ */
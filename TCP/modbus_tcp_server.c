@@ -0,0 +1,390 @@
+/*
+ * modbus_tcp_server.c
+ *
+ *  Created on: 16 ott 2026
+ *      Author: fabizani
+ *
+ * Ogni connessione ha un buffer di ricezione ed uno di trasmissione preallocati: le richieste
+ * arrivate insieme (client che ne spediscono più di una senza attendere) sono servite tutte nello
+ * stesso giro e le risposte accodate e spedite con una sola send. Se il client non legge le
+ * risposte smettiamo di leggere le sue richieste finché il buffer di trasmissione non si svuota.
+ */
+
+#define _GNU_SOURCE
+#include <TCP/modbus_tcp_server.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/**************************************************************************************************
+ * 										DEFINEs & CONSTs
+ *************************************************************************************************/
+#define TCP_RX_BUFFER			1024	///< Spazio per più richieste consecutive dello stesso client
+#define TCP_TX_BUFFER			2048	///< Spazio per più risposte in attesa di essere spedite
+#define TCP_EVENTS_PER_POLL		64		///< Eventi estratti ad ogni epoll_wait
+#define TCP_LISTEN_BACKLOG		128
+
+/**************************************************************************************************
+ * 										TYPE DEFINITION
+ *************************************************************************************************/
+
+/// Connessione di un client
+typedef struct sTcpConn {
+	int fd;						///< Socket, -1 se lo slot è libero
+	uint16_t u16RxLength;		///< Byte ricevuti e non ancora elaborati
+	uint16_t u16TxLength;		///< Byte di risposta accodati
+	uint16_t u16TxSent;			///< Byte di risposta già spediti
+	uint8_t u8WaitOut;			///< In attesa di EPOLLOUT: il socket non accettava altri dati
+	uint16_t u16Generation;		///< Cambia ad ogni riuso dello slot: invalida le risposte differite
+	struct sTcpConn *next;		///< Prossimo slot libero
+	uint8_t rx[TCP_RX_BUFFER];
+	uint8_t tx[TCP_TX_BUFFER];
+} sTcpConn;
+
+struct sMODBUS_TcpServer {
+	MODBUS_t *handle;			///< Oggetto MODBUS che esegue le richieste
+	int listenFd;				///< Socket in ascolto
+	int epollFd;				///< Istanza epoll di tutte le connessioni
+	uint16_t u16Port;			///< Porta in ascolto
+	uint16_t u16MaxClients;		///< Numero di slot di connessione
+	uint16_t u16Clients;		///< Slot occupati
+	sTcpConn *conns;			///< Slot di connessione, allocati alla creazione
+	sTcpConn *freeList;			///< Slot liberi
+	MODBUS_TcpRequestFn requestFn;	///< Gestione delle richieste (default: esecuzione locale)
+	void *requestContext;		///< Contesto di requestFn
+};
+
+/**************************************************************************************************
+ *									DICHIARAZIONI PRIVATE
+ *************************************************************************************************/
+static void TcpServer_Accept(hMODBUS_TcpServer server);
+static void TcpServer_Close(hMODBUS_TcpServer server, sTcpConn *conn);
+static int TcpServer_Receive(hMODBUS_TcpServer server, sTcpConn *conn);
+static int TcpServer_Process(hMODBUS_TcpServer server, sTcpConn *conn);
+static int TcpServer_Flush(hMODBUS_TcpServer server, sTcpConn *conn);
+static uint16_t TcpServer_ProcessLocal(void *context, const sMODBUS_TcpRequest *request,
+		uint8_t *response);
+
+/**************************************************************************************************
+ * 										FUNZIONI PRIVATE
+ *************************************************************************************************/
+static void TcpServer_Accept(hMODBUS_TcpServer server) {
+	for (;;) {
+		int fd = accept4(server->listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (fd < 0)
+			return;
+
+		// Slot esauriti: chiudiamo subito, il client riproverà
+		sTcpConn *conn = server->freeList;
+		if (conn == NULL) {
+			close(fd);
+			continue;
+		}
+
+		// Le risposte sono piccole: spediamole senza attendere l'algoritmo di Nagle
+		int one = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+		struct epoll_event ev = { .events = EPOLLIN, .data.ptr = conn };
+		if (epoll_ctl(server->epollFd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+			close(fd);
+			continue;
+		}
+
+		server->freeList = conn->next;
+		conn->fd = fd;
+		conn->u16RxLength = 0;
+		conn->u16TxLength = 0;
+		conn->u16TxSent = 0;
+		conn->u8WaitOut = 0;
+		server->u16Clients++;
+	}
+}
+
+static void TcpServer_Close(hMODBUS_TcpServer server, sTcpConn *conn) {
+	// Già chiusa, ad esempio da una MODBUS_TcpServer_Reply eseguita dentro requestFn
+	if (conn->fd < 0)
+		return;
+
+	epoll_ctl(server->epollFd, EPOLL_CTL_DEL, conn->fd, NULL);
+	close(conn->fd);
+
+	conn->fd = -1;
+	conn->u16Generation++;
+	conn->next = server->freeList;
+	server->freeList = conn;
+	server->u16Clients--;
+}
+
+/**
+ * Legge i dati disponibili ed elabora le richieste complete.
+ * @return Richieste servite, -1 se la connessione va chiusa
+ */
+static int TcpServer_Receive(hMODBUS_TcpServer server, sTcpConn *conn) {
+	ssize_t n = recv(conn->fd, &conn->rx[conn->u16RxLength], TCP_RX_BUFFER - conn->u16RxLength, 0);
+
+	if (n == 0)
+		return -1;
+	if (n < 0)
+		return (errno == EAGAIN || errno == EINTR) ? 0 : -1;
+
+	conn->u16RxLength += n;
+	return TcpServer_Process(server, conn);
+}
+
+/**
+ * Esegue le richieste complete presenti nel buffer di ricezione, accodando le risposte.
+ * @return Richieste servite, -1 se il client ha spedito dati non validi
+ */
+static int TcpServer_Process(hMODBUS_TcpServer server, sTcpConn *conn) {
+	uint16_t consumed = 0;
+	int served = 0;
+
+	while (conn->u16RxLength - consumed >= MBAP_HEADER_SIZE) {
+		const uint8_t *request = &conn->rx[consumed];
+		uint16_t length = MBAP_GET16(request, MBAP_LENGTH);
+
+		// Header non valido: lo stream non è più sincronizzato, chiudiamo la connessione
+		if (MBAP_GET16(request, MBAP_PROTOCOL) != 0 || length < 2 || length > MODBUS_ADU_MAX_SIZE)
+			return -1;
+
+		if (conn->u16RxLength - consumed < MBAP_PREFIX_SIZE + length)
+			break;
+
+		// Nessuno spazio per la risposta: spediamo quelle accodate. Se il socket non le accetta
+		// tutte, il resto delle richieste viene elaborato dopo la spedizione
+		if (TCP_TX_BUFFER - conn->u16TxLength < MODBUS_TCP_ADU_MAX_SIZE) {
+			if (TcpServer_Flush(server, conn) != 0)
+				return -1;
+			if (conn->u16TxLength != 0)
+				break;
+		}
+
+		// La risposta viene costruita direttamente nel buffer di trasmissione, dopo l'header
+		uint8_t *response = &conn->tx[conn->u16TxLength];
+		sMODBUS_TcpRequest tcpRequest = {
+			.u32Client = ((uint32_t) conn->u16Generation << 16) | (conn - server->conns),
+			.u16Transaction = MBAP_GET16(request, MBAP_TRANSACTION),
+			.request = &request[MBAP_UNIT],
+			.u16Length = length,
+		};
+		uint16_t respLength = server->requestFn(server->requestContext, &tcpRequest,
+				&response[MBAP_UNIT]);
+
+		// Una risposta differita consegnata in modo sincrono può aver chiuso la connessione
+		if (conn->fd < 0)
+			return -1;
+
+		if (respLength != 0) {
+			memcpy(response, request, MBAP_LENGTH);		// Transaction ID e Protocol ID
+			MBAP_PUT16(response, MBAP_LENGTH, respLength);
+			conn->u16TxLength += MBAP_PREFIX_SIZE + respLength;
+			served++;
+		}
+
+		consumed += MBAP_PREFIX_SIZE + length;
+	}
+
+	conn->u16RxLength -= consumed;
+	memmove(&conn->rx[0], &conn->rx[consumed], conn->u16RxLength);
+
+	if (TcpServer_Flush(server, conn) != 0)
+		return -1;
+
+	return served;
+}
+
+/**
+ * Spedisce le risposte accodate. Se il socket non accetta tutto si attende EPOLLOUT, senza
+ * leggere altre richieste; a buffer vuoto si torna ad attendere EPOLLIN.
+ * @return 0, oppure -1 se la connessione va chiusa
+ */
+static int TcpServer_Flush(hMODBUS_TcpServer server, sTcpConn *conn) {
+	while (conn->u16TxSent < conn->u16TxLength) {
+		ssize_t n = send(conn->fd, &conn->tx[conn->u16TxSent], conn->u16TxLength - conn->u16TxSent,
+				MSG_NOSIGNAL);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno != EAGAIN)
+				return -1;
+
+			if (!conn->u8WaitOut) {
+				struct epoll_event ev = { .events = EPOLLOUT, .data.ptr = conn };
+				epoll_ctl(server->epollFd, EPOLL_CTL_MOD, conn->fd, &ev);
+				conn->u8WaitOut = 1;
+			}
+			return 0;
+		}
+		conn->u16TxSent += n;
+	}
+
+	conn->u16TxLength = 0;
+	conn->u16TxSent = 0;
+
+	if (conn->u8WaitOut) {
+		struct epoll_event ev = { .events = EPOLLIN, .data.ptr = conn };
+		epoll_ctl(server->epollFd, EPOLL_CTL_MOD, conn->fd, &ev);
+		conn->u8WaitOut = 0;
+	}
+	return 0;
+}
+
+// Gestione di default: esecuzione con le funzioni dell'oggetto MODBUS del server
+static uint16_t TcpServer_ProcessLocal(void *context, const sMODBUS_TcpRequest *request,
+		uint8_t *response) {
+	return MODBUS_ProcessRequest(context, request->request, request->u16Length, response);
+}
+
+/**************************************************************************************************
+ * 										METODI DELL'ADT
+ *************************************************************************************************/
+hMODBUS_TcpServer MODBUS_TcpServer_New(MODBUS_t *handle, uint16_t port, uint16_t maxClients) {
+	hMODBUS_TcpServer server = calloc(1, sizeof(struct sMODBUS_TcpServer));
+	struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(port),
+			.sin_addr.s_addr = htonl(INADDR_ANY) };
+	socklen_t addrLength = sizeof(addr);
+	int one = 1;
+
+	if (server == NULL)
+		return NULL;
+
+	server->handle = handle;
+	server->requestFn = TcpServer_ProcessLocal;
+	server->requestContext = handle;
+	server->u16MaxClients = maxClients;
+	server->conns = calloc(maxClients, sizeof(sTcpConn));
+	server->listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	server->epollFd = epoll_create1(EPOLL_CLOEXEC);
+
+	if (server->conns == NULL || server->listenFd < 0 || server->epollFd < 0)
+		goto error;
+
+	setsockopt(server->listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	if (bind(server->listenFd, (struct sockaddr*) &addr, sizeof(addr)) != 0
+			|| listen(server->listenFd, TCP_LISTEN_BACKLOG) != 0
+			|| getsockname(server->listenFd, (struct sockaddr*) &addr, &addrLength) != 0)
+		goto error;
+	server->u16Port = ntohs(addr.sin_port);
+
+	// Il socket in ascolto è l'unico registrato senza puntatore alla connessione
+	struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+	if (epoll_ctl(server->epollFd, EPOLL_CTL_ADD, server->listenFd, &ev) != 0)
+		goto error;
+
+	for (uint16_t i = maxClients; i > 0; i--) {
+		server->conns[i - 1].fd = -1;
+		server->conns[i - 1].next = server->freeList;
+		server->freeList = &server->conns[i - 1];
+	}
+
+	return server;
+
+error:
+	if (server->listenFd >= 0)
+		close(server->listenFd);
+	if (server->epollFd >= 0)
+		close(server->epollFd);
+	free(server->conns);
+	free(server);
+	return NULL;
+}
+
+void MODBUS_TcpServer_Delete(hMODBUS_TcpServer server) {
+	for (uint16_t i = 0; i < server->u16MaxClients; i++) {
+		if (server->conns[i].fd >= 0)
+			close(server->conns[i].fd);
+	}
+
+	close(server->listenFd);
+	close(server->epollFd);
+	free(server->conns);
+	free(server);
+}
+
+int MODBUS_TcpServer_Poll(hMODBUS_TcpServer server, int timeoutMs) {
+	struct epoll_event events[TCP_EVENTS_PER_POLL];
+	int served = 0;
+
+	int n = epoll_wait(server->epollFd, events, TCP_EVENTS_PER_POLL, timeoutMs);
+	if (n < 0)
+		return (errno == EINTR) ? 0 : -1;
+
+	for (int i = 0; i < n; i++) {
+		sTcpConn *conn = events[i].data.ptr;
+		int result = 0;
+
+		if (conn == NULL) {
+			TcpServer_Accept(server);
+			continue;
+		}
+
+		if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+			result = -1;
+		} else if (events[i].events & EPOLLOUT) {
+			// Buffer svuotato: riprendiamo le richieste rimaste in attesa
+			result = TcpServer_Flush(server, conn);
+			if (result == 0 && conn->u16TxLength == 0)
+				result = TcpServer_Process(server, conn);
+		} else if (events[i].events & EPOLLIN) {
+			result = TcpServer_Receive(server, conn);
+		}
+
+		if (result < 0)
+			TcpServer_Close(server, conn);
+		else
+			served += result;
+	}
+
+	return served;
+}
+
+void MODBUS_TcpServer_SetRequestFn(hMODBUS_TcpServer server, MODBUS_TcpRequestFn requestFn,
+		void *context) {
+	server->requestFn = requestFn;
+	server->requestContext = context;
+}
+
+uint8_t MODBUS_TcpServer_Reply(hMODBUS_TcpServer server, uint32_t client, uint16_t transaction,
+		const uint8_t *response, uint16_t length) {
+	if (!MODBUS_TcpServer_IsConnected(server, client) || length > MODBUS_ADU_MAX_SIZE)
+		return 0;
+
+	sTcpConn *conn = &server->conns[client & 0xFFFF];
+
+	if (TCP_TX_BUFFER - conn->u16TxLength < MBAP_PREFIX_SIZE + length)
+		return 0;
+
+	uint8_t *frame = &conn->tx[conn->u16TxLength];
+	MBAP_PUT16(frame, MBAP_TRANSACTION, transaction);
+	MBAP_PUT16(frame, MBAP_PROTOCOL, 0);
+	MBAP_PUT16(frame, MBAP_LENGTH, length);
+	memcpy(&frame[MBAP_UNIT], response, length);
+	conn->u16TxLength += MBAP_PREFIX_SIZE + length;
+
+	if (TcpServer_Flush(server, conn) != 0)
+		TcpServer_Close(server, conn);
+
+	return 1;
+}
+
+uint8_t MODBUS_TcpServer_IsConnected(const hMODBUS_TcpServer server, uint32_t client) {
+	uint16_t index = client & 0xFFFF;
+
+	// Slot chiuso o riassegnato ad un altro client dopo la richiesta
+	return index < server->u16MaxClients && server->conns[index].fd >= 0
+			&& server->conns[index].u16Generation == (client >> 16);
+}
+
+uint16_t MODBUS_TcpServer_GetPort(const hMODBUS_TcpServer server) {
+	return server->u16Port;
+}
+
+uint16_t MODBUS_TcpServer_GetClientCount(const hMODBUS_TcpServer server) {
+	return server->u16Clients;
+}
@@ -0,0 +1,84 @@
+/*
+ * modbus_tcp_server.h
+ *
+ *  Created on: 16 ott 2026
+ *      Author: fabizani
+ *
+ *  Server Modbus TCP per Linux. Un solo thread gestisce tutte le connessioni con epoll: le
+ *  richieste vengono estratte dall'header MBAP ed eseguite con MODBUS_ProcessRequest sull'oggetto
+ *  MODBUS indicato, quindi con le stesse funzioni di lettura/scrittura (callback, banchi, mappe)
+ *  dello Slave RTU.
+ *
+ *  ES:
+ *  	MODBUS_t *local = MODBUS_NewHandle(NULL);
+ *  	MODBUS_Holdings_SetBank(local, regs, 0, 100);
+ *  	hMODBUS_TcpServer server = MODBUS_TcpServer_New(local, MODBUS_TCP_PORT, 256);
+ *  	for (;;)
+ *  		MODBUS_TcpServer_Poll(server, 100);
+ */
+
+#ifndef TCP_MODBUS_TCP_SERVER_H_
+#define TCP_MODBUS_TCP_SERVER_H_
+
+#include <stdint.h>
+#include <TCP/modbus_tcp.h>
+
+/**************************************************************************************************
+ * 										TYPE DECLARATION
+ **************************************************************************************************/
+// Dichiarazione dell'ADT
+typedef struct sMODBUS_TcpServer* hMODBUS_TcpServer;
+
+/// Richiesta ricevuta da un client
+typedef struct {
+	uint32_t u32Client;			///< Connessione di provenienza, da passare a MODBUS_TcpServer_Reply
+	uint16_t u16Transaction;	///< Transaction ID da restituire nella risposta
+	const uint8_t *request;		///< Unit ID + PDU
+	uint16_t u16Length;			///< Lunghezza della richiesta
+} sMODBUS_TcpRequest;
+
+/**
+ * Gestione delle richieste alternativa all'esecuzione locale (es. gateway verso linee RTU).
+ * @param void*                     Contesto passato a MODBUS_TcpServer_SetRequestFn
+ * @param const sMODBUS_TcpRequest* Richiesta; i dati sono validi solo durante la chiamata
+ * @param uint8_t*                  Buffer dove scrivere subito la risposta (Unit ID + PDU)
+ * @return Lunghezza della risposta scritta; 0 se la risposta è differita (MODBUS_TcpServer_Reply)
+ *         oppure se non si deve rispondere
+ */
+typedef uint16_t (*MODBUS_TcpRequestFn)(void*, const sMODBUS_TcpRequest*, uint8_t*);
+
+/**************************************************************************************************
+ * 										METODI DELL'ADT
+ **************************************************************************************************/
+
+// Apre il socket in ascolto su tutte le interfacce (port 0: porta scelta dal sistema).
+// Ritorna NULL in caso di errore.
+// Con handle NULL va impostata una MODBUS_TcpRequestFn.
+hMODBUS_TcpServer MODBUS_TcpServer_New(MODBUS_t *handle, uint16_t port, uint16_t maxClients);
+
+// Chiude tutte le connessioni e libera la memoria
+void MODBUS_TcpServer_Delete(hMODBUS_TcpServer server);
+
+// Attende al più timeoutMs eventi sui socket e li gestisce.
+// Ritorna il numero di richieste servite, -1 in caso di errore.
+int MODBUS_TcpServer_Poll(hMODBUS_TcpServer server, int timeoutMs);
+
+// Sostituisce l'esecuzione delle richieste con MODBUS_ProcessRequest sull'oggetto MODBUS
+void MODBUS_TcpServer_SetRequestFn(hMODBUS_TcpServer server, MODBUS_TcpRequestFn requestFn,
+		void *context);
+
+// Spedisce una risposta differita. Ritorna 0 se il client si è disconnesso nel frattempo
+// o se il suo buffer di trasmissione è pieno.
+uint8_t MODBUS_TcpServer_Reply(hMODBUS_TcpServer server, uint32_t client, uint16_t transaction,
+		const uint8_t *response, uint16_t length);
+
+// Il client che ha spedito la richiesta è ancora connesso
+uint8_t MODBUS_TcpServer_IsConnected(const hMODBUS_TcpServer server, uint32_t client);
+
+// Porta effettivamente in ascolto
+uint16_t MODBUS_TcpServer_GetPort(const hMODBUS_TcpServer server);
+
+// Numero di client connessi
+uint16_t MODBUS_TcpServer_GetClientCount(const hMODBUS_TcpServer server);
+
+#endif /* TCP_MODBUS_TCP_SERVER_H_ */
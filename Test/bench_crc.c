@@ -0,0 +1,64 @@
+/*
+ * bench_crc.c
+ *
+ *  Created on: 16 ott 2026
+ *      Author: fabizani
+ *
+ *  Micro-benchmark del backend CRC selezionato (MODBUS_CRC_BACKEND) su una risposta FC3 di
+ *  125 registri (255 byte, CRC escluso). Su x86 riporta i byte per ciclo del TSC, altrove i byte
+ *  per nanosecondo.
+ */
+
+#include <Core/modbus_crc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define FRAME_LENGTH	255
+#define ITERATIONS		200000
+
+static const char *const backendNames[] = { "bitwise", "nibble", "table", "slice4", "slice8" };
+
+static uint64_t nowNs(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000u + now.tv_nsec;
+}
+
+int main(void) {
+	static uint8_t frame[FRAME_LENGTH];
+	volatile uint16_t sink = 0;
+
+	for (uint16_t i = 0; i < FRAME_LENGTH; i++)
+		frame[i] = rand();
+
+	// Riscaldamento: tabelle in cache e frequenza della CPU stabile
+	for (uint32_t i = 0; i < ITERATIONS / 10; i++)
+		sink ^= MODBUS_CRC_Update(MODBUS_CRC_INIT, frame, FRAME_LENGTH);
+
+	uint64_t startNs = nowNs();
+#if defined(__x86_64__) || defined(__i386__)
+	uint64_t startCycles = __rdtsc();
+#endif
+	for (uint32_t i = 0; i < ITERATIONS; i++) {
+		frame[0] = i;
+		sink ^= MODBUS_CRC_Update(MODBUS_CRC_INIT, frame, FRAME_LENGTH);
+	}
+#if defined(__x86_64__) || defined(__i386__)
+	uint64_t cycles = __rdtsc() - startCycles;
+#endif
+	uint64_t elapsedNs = nowNs() - startNs;
+	double bytes = (double) FRAME_LENGTH * ITERATIONS;
+
+	printf("%-8s %8.1f ns/frame %8.3f byte/ns", backendNames[MODBUS_CRC_BACKEND],
+			(double) elapsedNs / ITERATIONS, bytes / elapsedNs);
+#if defined(__x86_64__) || defined(__i386__)
+	printf(" %8.3f byte/ciclo", bytes / cycles);
+#endif
+	printf("\n");
+
+	return sink == 0x1234 ? 1 : 0;
+}
@@ -0,0 +1,103 @@
+/*
+ * mock_port.c
+ *
+ *  Created on: 16 ott 2026
+ *      Author: fabizani
+ */
+
+#include "mock_port.h"
+#include <Core/modbus_crc.h>
+#include <string.h>
+
+/**************************************************************************************************
+ * 										FUNZIONI PRIVATE
+ *************************************************************************************************/
+static uint8_t Mock_Transmit(void *context, const uint8_t *data, uint16_t length) {
+	sMockPort *mock = context;
+
+	if (mock->u8TxFail) {
+		mock->u8TxFail = 0;
+		return 0;
+	}
+
+	memcpy(mock->au8Tx, data, length);
+	mock->u16TxLength = length;
+	mock->u16TxFrames++;
+	return 1;
+}
+
+static void Mock_EnableRx(void *context) {
+	sMockPort *mock = context;
+
+	mock->u8RxEnabled = 1;
+}
+
+static void Mock_DisableRx(void *context) {
+	sMockPort *mock = context;
+
+	mock->u8RxEnabled = 0;
+}
+
+static void Mock_LockRx(void *context) {
+	sMockPort *mock = context;
+
+	mock->u8Locked = 1;
+	mock->u16Locks++;
+}
+
+static void Mock_UnlockRx(void *context) {
+	sMockPort *mock = context;
+
+	mock->u8Locked = 0;
+	if (mock->u16Held != 0) {
+		uint16_t length = mock->u16Held;
+		mock->u16Held = 0;
+		MODBUS_ReceiveBlock(mock->pxHeldHandle, mock->pu8Held, length);
+	}
+}
+
+/**************************************************************************************************
+ * 										METODI PUBBLICI
+ *************************************************************************************************/
+void MockPort_Init(sMODBUS_Port *port, sMockPort *mock, uint32_t baudrate) {
+	memset(mock, 0, sizeof(sMockPort));
+	memset(port, 0, sizeof(sMODBUS_Port));
+
+	port->context = mock;
+	port->transmit = Mock_Transmit;
+	port->enableRx = Mock_EnableRx;
+	port->disableRx = Mock_DisableRx;
+	port->lockRx = Mock_LockRx;
+	port->unlockRx = Mock_UnlockRx;
+	port->u32Baudrate = baudrate;
+}
+
+void MockPort_Receive(MODBUS_t *handle, const uint8_t *frame, uint16_t length, uint16_t chunk) {
+	sMockPort *mock = MODBUS_GetPort(handle)->context;
+
+	if (!mock->u8RxEnabled)
+		return;
+
+	for (uint16_t sent = 0; sent < length; sent += chunk) {
+		uint16_t size = (length - sent < chunk) ? length - sent : chunk;
+		MODBUS_ReceiveBlock(handle, &frame[sent], size);
+	}
+
+	MODBUS_SetRxComplete(handle);
+}
+
+void MockPort_HoldDuringLock(MODBUS_t *handle, const uint8_t *data, uint16_t length) {
+	sMockPort *mock = MODBUS_GetPort(handle)->context;
+
+	mock->pxHeldHandle = handle;
+	mock->pu8Held = data;
+	mock->u16Held = length;
+}
+
+uint16_t MockPort_AppendCRC(uint8_t *frame, uint16_t length) {
+	uint16_t crc = calcCRC(frame, length);
+
+	frame[length] = crc >> 8;
+	frame[length + 1] = crc & 0xFF;
+	return length + 2;
+}
@@ -0,0 +1,45 @@
+/*
+ * mock_port.h
+ *
+ *  Created on: 16 ott 2026
+ *      Author: fabizani
+ *
+ *  Driver della porta finto, per i test su host: la trasmissione viene salvata in un buffer e la
+ *  ricezione arriva dal test, spezzata in blocchi come farebbe un DMA (MODBUS_ReceiveBlock).
+ */
+
+#ifndef TEST_MOCK_PORT_H_
+#define TEST_MOCK_PORT_H_
+
+#include <Core/modbus_core.h>
+
+#define MOCK_TX_SIZE		300
+
+/// Contesto del driver finto
+typedef struct {
+	uint8_t au8Tx[MOCK_TX_SIZE];	///< Ultima frame trasmessa
+	uint16_t u16TxLength;			///< Lunghezza dell'ultima frame trasmessa
+	uint16_t u16TxFrames;			///< Frame trasmesse dall'inizio
+	uint8_t u8TxFail;				///< La prossima trasmissione fallisce (HAL_BUSY)
+	uint8_t u8RxEnabled;			///< Ricezione abilitata dalla libreria
+	uint16_t u16Locks;				///< Chiamate a lockRx
+	uint8_t u8Locked;				///< Produttore sospeso dalla libreria (lockRx)
+	MODBUS_t *pxHeldHandle;			///< Oggetto a cui consegnare i byte trattenuti
+	const uint8_t *pu8Held;			///< Byte "arrivati" durante lockRx, consegnati da unlockRx
+	uint16_t u16Held;				///< Numero di byte trattenuti
+} sMockPort;
+
+// Prepara il driver; la porta viene aperta da MODBUS_NewHandle
+void MockPort_Init(sMODBUS_Port *port, sMockPort *mock, uint32_t baudrate);
+
+// Consegna una frame (CRC compreso) a blocchi di chunk byte, poi ne segnala la fine
+void MockPort_Receive(MODBUS_t *handle, const uint8_t *frame, uint16_t length, uint16_t chunk);
+
+// I byte indicati arrivano mentre la libreria svuota la prossima frame: come l'hardware, il
+// driver li trattiene e li consegna all'uscita dalla sezione critica
+void MockPort_HoldDuringLock(MODBUS_t *handle, const uint8_t *data, uint16_t length);
+
+// Aggiunge il CRC in coda a length byte; ritorna la lunghezza della frame completa
+uint16_t MockPort_AppendCRC(uint8_t *frame, uint16_t length);
+
+#endif /* TEST_MOCK_PORT_H_ */
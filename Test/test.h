@@ -0,0 +1,28 @@
+/*
+ * test.h
+ *
+ *  Created on: 16 ott 2026
+ *      Author: fabizani
+ *
+ *  Mini-framework per i test su host: CHECK non interrompe il test, conta gli errori e stampa
+ *  file e riga di ognuno; TEST_END ritorna il codice di uscita per make.
+ */
+
+#ifndef TEST_TEST_H_
+#define TEST_TEST_H_
+
+#include <stdio.h>
+
+static int testFailures = 0;
+
+#define CHECK(cond) do { \
+	if (!(cond)) { \
+		printf("%s:%d: CHECK(%s) fallito\n", __FILE__, __LINE__, #cond); \
+		testFailures++; \
+	} \
+} while (0)
+
+#define TEST_END(name) \
+	(printf("%s: %s\n", name, testFailures ? "FALLITO" : "OK"), testFailures ? 1 : 0)
+
+#endif /* TEST_TEST_H_ */
@@ -0,0 +1,65 @@
+/*
+ * test_crc.c
+ *
+ *  Created on: 16 ott 2026
+ *      Author: fabizani
+ *
+ *  Confronta il backend CRC selezionato (MODBUS_CRC_BACKEND) con l'algoritmo bit a bit della
+ *  specifica MODBUS, su buffer casuali di ogni lunghezza e spezzati in più blocchi.
+ */
+
+#include <Core/modbus_crc.h>
+#include <stdlib.h>
+#include "test.h"
+
+#define MAX_LENGTH		600
+
+// Implementazione di riferimento, come nella specifica MODBUS over Serial Line
+static uint16_t referenceCRC(const uint8_t *buffer, uint16_t length) {
+	uint16_t crc = MODBUS_CRC_INIT;
+
+	for (uint16_t i = 0; i < length; i++) {
+		crc ^= buffer[i];
+		for (uint8_t j = 0; j < 8; j++)
+			crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : crc >> 1;
+	}
+
+	return crc;
+}
+
+int main(void) {
+	static uint8_t buffer[MAX_LENGTH + 2];
+	const uint8_t check[] = "123456789";
+
+	// Valore di controllo del CRC-16/MODBUS
+	CHECK(MODBUS_CRC_Update(MODBUS_CRC_INIT, check, 9) == 0x4B37);
+
+	srand(1);
+	for (uint16_t length = 0; length <= MAX_LENGTH; length++) {
+		for (uint16_t i = 0; i < length; i++)
+			buffer[i] = rand();
+
+		uint16_t expected = referenceCRC(buffer, length);
+		CHECK(MODBUS_CRC_Update(MODBUS_CRC_INIT, buffer, length) == expected);
+
+		// Stesso risultato a blocchi di lunghezza qualsiasi e byte per byte
+		uint16_t split = length / 3;
+		uint16_t crc = MODBUS_CRC_Update(MODBUS_CRC_INIT, buffer, split);
+		CHECK(MODBUS_CRC_Update(crc, &buffer[split], length - split) == expected);
+
+		crc = MODBUS_CRC_INIT;
+		for (uint16_t i = 0; i < length; i++)
+			crc = MODBUS_CRC_UpdateByte(crc, buffer[i]);
+		CHECK(crc == expected);
+
+		// calcCRC ritorna i byte nell'ordine di spedizione: con il CRC in coda il registro va a zero
+		uint16_t sent = calcCRC(buffer, length);
+		CHECK(sent == (uint16_t) ((expected << 8) | (expected >> 8)));
+		buffer[length] = sent >> 8;
+		buffer[length + 1] = sent & 0xFF;
+		CHECK(MODBUS_CRC_Update(MODBUS_CRC_INIT, buffer, length + 2) == 0);
+	}
+
+	printf("backend %d ", MODBUS_CRC_BACKEND);
+	return TEST_END("test_crc");
+}
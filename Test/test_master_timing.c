@@ -0,0 +1,174 @@
+/*
+ * test_master_timing.c
+ *
+ *  Created on: 16 ott 2026
+ *      Author: fabizani
+ *
+ *  Tempi del Master sul driver finto: il timeout adattativo converge sul tempo di risposta dello
+ *  slave, e una risposta arrivata dopo il timeout non diventa un campione né finisce in testa
+ *  alla risposta successiva: lo slave interrogato dopo non viene dato per guasto.
+ */
+
+#include "Core/modbus_core.h"
+#include "mock_port.h"
+#include "test.h"
+
+#define SLAVE_ID		3
+#define NEXT_ID			4		///< Slave interrogato dopo il timeout di SLAVE_ID
+#define RESPONSE_ms		20		///< Tempo di risposta dello slave simulato
+#define FLOOR_ms		10
+#define CEILING_ms		1000
+#define SAMPLES			30		///< Risposte per arrivare a regime
+
+static uint8_t remoteID;
+static uint16_t remoteValue;
+static uint16_t remoteCount;
+static uint16_t timeouts;
+
+static void remoteBlock(const uint8_t id, const uint16_t address, const uint16_t count,
+		const uint16_t *values) {
+	(void) address;
+	remoteID = id;
+	remoteValue = values[0];
+	remoteCount += count;
+}
+
+static void rxTimeout(void) {
+	timeouts++;
+}
+
+static MODBUS_t* NewMaster(sMODBUS_Port *port, sMockPort *mock) {
+	MockPort_Init(port, mock, 115200);
+	MODBUS_t *master = MODBUS_NewHandle(port);
+
+	MODBUS_SetMode(master, MODBUS_Mode_Master);
+	MODBUS_Holdings_SetBlockRemoteFn(master, remoteBlock);
+	MODBUS_SetRxTimeoutCallback(master, rxTimeout);
+	CHECK(MODBUS_SetAdaptiveTimeout(master, FLOOR_ms, CEILING_ms));
+	remoteCount = 0;
+	timeouts = 0;
+
+	return master;
+}
+
+// Risposta FC3 di un registro, CRC compreso; ritorna la lunghezza
+static uint16_t ReadResponse(uint8_t slaveID, uint16_t value, uint8_t *frame) {
+	frame[0] = slaveID;
+	frame[1] = FC_ReadHoldingRegisters;
+	frame[2] = 2;
+	frame[3] = value >> 8;
+	frame[4] = value & 0xFF;
+
+	return MockPort_AppendCRC(frame, 5);
+}
+
+// Spedisce una lettura e lascia passare elapsedMs; con reply lo slave risponde dopo quel tempo
+static void Exchange(MODBUS_t *master, uint8_t slaveID, uint16_t elapsedMs, uint8_t reply,
+		uint16_t value) {
+	sMODBUS_Commmand cmd = { .functionCode = FC_ReadHoldingRegisters, .slaveID = slaveID,
+			.regAddress = 0, .length = 1 };
+	uint8_t frame[8];
+
+	CHECK(MODBUS_QueueCommand(master, &cmd));
+	MODBUS_ExecuteTask(master);
+	for (uint16_t i = 0; i < elapsedMs; i++)
+		MODBUS_MasterTickRxTimer(master);
+
+	if (reply)
+		MockPort_Receive(master, frame, ReadResponse(slaveID, value, frame), 4);
+	MODBUS_ExecuteTask(master);
+	MODBUS_ExecuteTask(master);
+}
+
+// Con risposte regolari il timeout scende dal tetto fino al tempo di risposta
+static void testConverges(void) {
+	sMockPort mock;
+	sMODBUS_Port port;
+	MODBUS_t *master = NewMaster(&port, &mock);
+	uint16_t previous = MODBUS_GetResponseTimeout(master, SLAVE_ID);
+
+	CHECK(previous == CEILING_ms);
+	for (uint16_t i = 0; i < SAMPLES; i++) {
+		Exchange(master, SLAVE_ID, RESPONSE_ms, 1, i);
+		CHECK(remoteValue == i);
+
+		uint16_t timeout = MODBUS_GetResponseTimeout(master, SLAVE_ID);
+		CHECK(timeout <= previous);
+		previous = timeout;
+	}
+
+	CHECK(previous >= RESPONSE_ms && previous <= RESPONSE_ms + 5);
+	CHECK(remoteCount == SAMPLES && timeouts == 0);
+
+	MODBUS_DeleteHandle(master);
+}
+
+// Dopo un timeout la risposta in ritardo viene scartata: il timeout stimato non cambia
+static void testLateSampleDropped(void) {
+	sMockPort mock;
+	sMODBUS_Port port;
+	MODBUS_t *master = NewMaster(&port, &mock);
+	uint8_t frame[8];
+
+	for (uint16_t i = 0; i < SAMPLES; i++)
+		Exchange(master, SLAVE_ID, RESPONSE_ms, 1, i);
+	uint16_t converged = MODBUS_GetResponseTimeout(master, SLAVE_ID);
+
+	// La risposta arriva a timeout scaduto, prima che il task se ne accorga
+	remoteCount = 0;
+	Exchange(master, SLAVE_ID, converged, 1, 0xDEAD);
+	CHECK(timeouts == 1 && remoteCount == 0);
+	uint16_t lost = MODBUS_GetResponseTimeout(master, SLAVE_ID);
+	CHECK(lost > converged);
+
+	// Un'altra risposta in ritardo, a Master fermo
+	MockPort_Receive(master, frame, ReadResponse(SLAVE_ID, 0xBEEF, frame), 4);
+	MODBUS_ExecuteTask(master);
+	CHECK(MODBUS_GetResponseTimeout(master, SLAVE_ID) == lost);
+
+	// La lettura successiva riceve solo la propria risposta, con un campione valido
+	Exchange(master, SLAVE_ID, RESPONSE_ms, 1, 0x0042);
+	CHECK(remoteCount == 1 && remoteValue == 0x0042);
+	CHECK(timeouts == 1);
+	CHECK(MODBUS_GetResponseTimeout(master, SLAVE_ID) <= lost);
+
+	MODBUS_DeleteHandle(master);
+}
+
+// La risposta in ritardo di uno slave non fa fallire lo slave successivo, né gli viene consegnata
+static void testLateReplyHealth(void) {
+	sMockPort mock;
+	sMODBUS_Port port;
+	MODBUS_t *master = NewMaster(&port, &mock);
+	sMODBUS_SlaveHealth health;
+	uint8_t frame[8];
+
+	// Al primo errore lo slave va in backoff: un fallimento ingiusto si vedrebbe subito
+	CHECK(MODBUS_SetSlaveBackoff(master, 1, 100, 1000));
+
+	Exchange(master, SLAVE_ID, CEILING_ms, 0, 0);
+	CHECK(timeouts == 1);
+	MockPort_Receive(master, frame, ReadResponse(SLAVE_ID, 0xDEAD, frame), 4);
+	MODBUS_ExecuteTask(master);
+
+	Exchange(master, NEXT_ID, RESPONSE_ms, 1, 0x0042);
+	CHECK(remoteCount == 1 && remoteID == NEXT_ID && remoteValue == 0x0042);
+	CHECK(timeouts == 1);
+
+	CHECK(MODBUS_GetSlaveHealth(master, NEXT_ID, &health));
+	CHECK(health.u8Failures == 0 && health.u16FrameErrors == 0 && health.u16Timeouts == 0);
+	CHECK(!health.u8Offline);
+
+	CHECK(MODBUS_GetSlaveHealth(master, SLAVE_ID, &health));
+	CHECK(health.u16Timeouts == 1 && health.u16FrameErrors == 0 && health.u8Offline);
+
+	MODBUS_DeleteHandle(master);
+}
+
+int main(void) {
+	testConverges();
+	testLateSampleDropped();
+	testLateReplyHealth();
+
+	return TEST_END("test_master_timing");
+}
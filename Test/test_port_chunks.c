@@ -0,0 +1,205 @@
+/*
+ * test_port_chunks.c
+ *
+ *  Created on: 16 ott 2026
+ *      Author: fabizani
+ *
+ *  Ricezione a blocchi (MODBUS_ReceiveBlock) e trasmissione asincrona, con il driver finto:
+ *  le stesse frame spezzate in blocchi di ogni dimensione devono dare la stessa risposta.
+ */
+
+#include <string.h>
+#include "mock_port.h"
+#include "test.h"
+
+#define BANK_SIZE		200
+
+static uint16_t holdings[BANK_SIZE];
+static uint16_t inputs[BANK_SIZE];
+static uint16_t remoteRegs[BANK_SIZE];
+static uint16_t remoteCount;
+
+static void remoteBlock(const uint8_t id, const uint16_t address, const uint16_t count,
+		const uint16_t *values) {
+	(void) id;
+	memcpy(&remoteRegs[address], values, count * sizeof(uint16_t));
+	remoteCount += count;
+}
+
+// FC3 di 125 registri: la risposta più lunga, 255 byte
+static void testSlaveRead(void) {
+	sMockPort mock;
+	sMODBUS_Port port;
+	uint8_t address = 1;
+	uint8_t request[8] = { 1, FC_ReadHoldingRegisters, 0, 10, 0, 125 };
+
+	MockPort_Init(&port, &mock, 115200);
+	MODBUS_t *slave = MODBUS_NewHandle(&port);
+	MODBUS_SetAddress(slave, &address);
+	MODBUS_Holdings_SetBank(slave, holdings, 0, BANK_SIZE);
+	uint16_t length = MockPort_AppendCRC(request, 6);
+
+	for (uint16_t chunk = 1; chunk <= length; chunk++) {
+		MockPort_Receive(slave, request, length, chunk);
+		MODBUS_ExecuteTask(slave);
+
+		CHECK(mock.u16TxFrames == chunk);
+		CHECK(mock.u16TxLength == 255);
+		CHECK(mock.au8Tx[2] == 250);
+		CHECK(mock.au8Tx[3] == holdings[10] >> 8 && mock.au8Tx[4] == (holdings[10] & 0xFF));
+		CHECK(mock.au8Tx[251] == holdings[134] >> 8 && mock.au8Tx[252] == (holdings[134] & 0xFF));
+	}
+
+	// CRC errato: nessuna risposta
+	request[7] ^= 0x01;
+	MockPort_Receive(slave, request, length, 3);
+	MODBUS_ExecuteTask(slave);
+	CHECK(mock.u16TxFrames == length);
+
+	MODBUS_DeleteHandle(slave);
+}
+
+// FC16 di 123 registri (255 byte) a blocchi: la richiesta più lunga
+static void testSlaveWrite(void) {
+	sMockPort mock;
+	sMODBUS_Port port;
+	uint8_t address = 1;
+	uint8_t request[260] = { 1, FC_WriteMultipleRegisters, 0, 20, 0, 123, 246 };
+
+	MockPort_Init(&port, &mock, 115200);
+	MODBUS_t *slave = MODBUS_NewHandle(&port);
+	MODBUS_SetAddress(slave, &address);
+	MODBUS_Inputs_SetBank(slave, inputs, 0, BANK_SIZE);
+
+	for (uint16_t chunk = 1; chunk <= 64; chunk++) {
+		for (uint16_t i = 0; i < 123; i++) {
+			request[7 + 2 * i] = chunk;
+			request[8 + 2 * i] = i;
+		}
+		uint16_t length = MockPort_AppendCRC(request, 7 + 246);
+
+		MockPort_Receive(slave, request, length, chunk);
+		MODBUS_ExecuteTask(slave);
+
+		CHECK(mock.u16TxLength == 8 && memcmp(mock.au8Tx, request, 6) == 0);
+		CHECK(inputs[20] == (chunk << 8) && inputs[142] == ((chunk << 8) | 122));
+	}
+
+	MODBUS_DeleteHandle(slave);
+}
+
+// TX asincrona: la risposta successiva attende MODBUS_SetTxComplete; una TX fallita libera i buffer
+static void testSlaveAsyncTx(void) {
+	sMockPort mock;
+	sMODBUS_Port port;
+	uint8_t address = 1;
+	uint8_t request[8] = { 1, FC_ReadHoldingRegisters, 0, 0, 0, 2 };
+
+	MockPort_Init(&port, &mock, 115200);
+	MODBUS_t *slave = MODBUS_NewHandle(&port);
+	MODBUS_SetAddress(slave, &address);
+	MODBUS_Holdings_SetBank(slave, holdings, 0, BANK_SIZE);
+	MODBUS_SetTxAsync(slave, 1);
+	uint16_t length = MockPort_AppendCRC(request, 6);
+
+	MockPort_Receive(slave, request, length, 4);
+	MODBUS_ExecuteTask(slave);
+	CHECK(mock.u16TxFrames == 1 && MODBUS_GetTxBusy(slave));
+
+	MockPort_Receive(slave, request, length, 4);
+	MODBUS_ExecuteTask(slave);
+	CHECK(mock.u16TxFrames == 1);
+
+	MODBUS_SetTxComplete(slave);
+	MODBUS_ExecuteTask(slave);
+	CHECK(mock.u16TxFrames == 2);
+	MODBUS_SetTxComplete(slave);
+
+	mock.u8TxFail = 1;
+	MockPort_Receive(slave, request, length, 4);
+	MODBUS_ExecuteTask(slave);
+	CHECK(mock.u16TxFrames == 2 && !MODBUS_GetTxBusy(slave));
+
+	MockPort_Receive(slave, request, length, 4);
+	MODBUS_ExecuteTask(slave);
+	CHECK(mock.u16TxFrames == 3);
+
+	MODBUS_DeleteHandle(slave);
+}
+
+// Byte della frame successiva arrivati mentre il task svuota la precedente: restano, CRC compreso
+static void testSlaveBackToBack(void) {
+	sMockPort mock;
+	sMODBUS_Port port;
+	uint8_t address = 1;
+	uint8_t first[8] = { 1, FC_ReadHoldingRegisters, 0, 0, 0, 2 };
+	uint8_t second[8] = { 1, FC_ReadHoldingRegisters, 0, 4, 0, 1 };
+
+	MockPort_Init(&port, &mock, 115200);
+	MODBUS_t *slave = MODBUS_NewHandle(&port);
+	MODBUS_SetAddress(slave, &address);
+	MODBUS_Holdings_SetBank(slave, holdings, 0, BANK_SIZE);
+	uint16_t length = MockPort_AppendCRC(first, 6);
+	MockPort_AppendCRC(second, 6);
+
+	MockPort_Receive(slave, first, length, length);
+	MockPort_HoldDuringLock(slave, second, 3);
+	MODBUS_ExecuteTask(slave);
+	CHECK(mock.u16TxFrames == 1 && mock.u16TxLength == 9 && mock.u16Locks != 0);
+
+	MockPort_Receive(slave, &second[3], length - 3, length);
+	MODBUS_ExecuteTask(slave);
+	CHECK(mock.u16TxFrames == 2 && mock.u16TxLength == 7);
+	CHECK(mock.au8Tx[3] == holdings[4] >> 8 && mock.au8Tx[4] == (holdings[4] & 0xFF));
+
+	MODBUS_DeleteHandle(slave);
+}
+
+// Master: risposta FC3 di 125 registri consegnata a blocchi
+static void testMasterResponse(void) {
+	sMockPort mock;
+	sMODBUS_Port port;
+	uint8_t response[260] = { 5, FC_ReadHoldingRegisters, 250 };
+	sMODBUS_Commmand cmd = { .functionCode = FC_ReadHoldingRegisters, .slaveID = 5,
+			.regAddress = 30, .length = 125 };
+
+	MockPort_Init(&port, &mock, 115200);
+	MODBUS_t *master = MODBUS_NewHandle(&port);
+	MODBUS_SetMode(master, MODBUS_Mode_Master);
+	MODBUS_Holdings_SetBlockRemoteFn(master, remoteBlock);
+
+	for (uint16_t i = 0; i < 125; i++) {
+		response[3 + 2 * i] = i >> 8;
+		response[4 + 2 * i] = i * 3;
+	}
+	uint16_t length = MockPort_AppendCRC(response, 253);
+
+	for (uint16_t chunk = 1; chunk <= 80; chunk++) {
+		remoteCount = 0;
+		CHECK(MODBUS_QueueCommand(master, &cmd));
+		MODBUS_ExecuteTask(master);
+		CHECK(mock.u16TxLength == 8 && mock.au8Tx[0] == 5);
+
+		MockPort_Receive(master, response, length, chunk);
+		MODBUS_ExecuteTask(master);
+		MODBUS_ExecuteTask(master);
+
+		CHECK(remoteCount == 125);
+		CHECK(remoteRegs[31] == 3 && remoteRegs[154] == ((124 * 3) & 0xFF));
+	}
+
+	MODBUS_DeleteHandle(master);
+}
+
+int main(void) {
+	for (uint16_t i = 0; i < BANK_SIZE; i++)
+		holdings[i] = i * 257 + 1;
+
+	testSlaveRead();
+	testSlaveWrite();
+	testSlaveAsyncTx();
+	testSlaveBackToBack();
+	testMasterResponse();
+
+	return TEST_END("test_port_chunks");
+}
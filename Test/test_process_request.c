@@ -0,0 +1,202 @@
+/*
+ * test_process_request.c
+ *
+ *  Created on: 16 ott 2026
+ *      Author: fabizani
+ *
+ *  Scritture FC5/6/15/16/22/23 andata e ritorno: la richiesta costruita dal Master
+ *  (MODBUS_BuildRequest) viene eseguita dallo Slave (MODBUS_ProcessRequest) e la risposta torna
+ *  al Master (MODBUS_ProcessResponse). Lo Slave è provato con i banchi, con le sole funzioni a
+ *  blocchi (come la glue generata dalla mappa) e con le sole funzioni per indirizzo.
+ */
+
+#include <string.h>
+#include "Core/modbus_core.h"
+#include "test.h"
+
+#define SLAVE_ID		7
+#define REGS_SIZE		64
+#define COILS_SIZE		64
+
+typedef enum {
+	Slave_Banks, Slave_BlockFns, Slave_AddressFns, SLAVE_KINDS
+} eSlaveKind;
+
+// Tabella dei registri dello Slave: la FC6/FC16 scrive gli inputs, la FC3 legge gli holdings,
+// quindi entrambe puntano agli stessi dati
+static uint16_t regs[REGS_SIZE];
+static uint8_t coils[COILS_SIZE / 8];
+static uint16_t remoteRegs[REGS_SIZE];
+
+/*
+ * Funzioni dello Slave
+ */
+static sMODBUS_ReadResult readReg(const uint16_t address) {
+	sMODBUS_ReadResult result = { .data = 0, .error = Exception_IllegalAddr };
+
+	if (address < REGS_SIZE) {
+		result.data = regs[address];
+		result.error = Exception_NoException;
+	}
+	return result;
+}
+
+static eMODBUS_Excpt writeReg(const uint16_t address, const uint16_t value) {
+	if (address >= REGS_SIZE)
+		return Exception_IllegalAddr;
+	regs[address] = value;
+	return Exception_NoException;
+}
+
+static eMODBUS_Excpt writeCoil(const uint16_t address, const uint16_t value) {
+	if (address >= COILS_SIZE)
+		return Exception_IllegalAddr;
+	if (value)
+		coils[address / 8] |= 1 << (address % 8);
+	else
+		coils[address / 8] &= ~(1 << (address % 8));
+	return Exception_NoException;
+}
+
+static eMODBUS_Excpt readRegs(const uint16_t address, const uint16_t count, uint16_t *values) {
+	if (address + count > REGS_SIZE)
+		return Exception_IllegalAddr;
+	memcpy(values, &regs[address], count * sizeof(uint16_t));
+	return Exception_NoException;
+}
+
+static eMODBUS_Excpt writeRegs(const uint16_t address, const uint16_t count,
+		const uint16_t *values) {
+	if (address + count > REGS_SIZE)
+		return Exception_IllegalAddr;
+	memcpy(&regs[address], values, count * sizeof(uint16_t));
+	return Exception_NoException;
+}
+
+static eMODBUS_Excpt writeCoils(const uint16_t address, const uint16_t count, const uint8_t *bits) {
+	if (address + count > COILS_SIZE)
+		return Exception_IllegalAddr;
+	for (uint16_t i = 0; i < count; i++)
+		writeCoil(address + i, (bits[i / 8] >> (i % 8)) & 1);
+	return Exception_NoException;
+}
+
+/*
+ * Funzioni del Master
+ */
+static void remoteBlock(const uint8_t id, const uint16_t address, const uint16_t count,
+		const uint16_t *values) {
+	(void) id;
+	memcpy(&remoteRegs[address], values, count * sizeof(uint16_t));
+}
+
+static MODBUS_t* NewSlave(eSlaveKind kind, uint8_t *address) {
+	MODBUS_t *slave = MODBUS_NewHandle(NULL);
+
+	MODBUS_SetAddress(slave, address);
+	switch (kind) {
+	case Slave_Banks:
+		MODBUS_Holdings_SetBank(slave, regs, 0, REGS_SIZE);
+		MODBUS_Inputs_SetBank(slave, regs, 0, REGS_SIZE);
+		MODBUS_Coils_SetBank(slave, coils, 0, COILS_SIZE);
+		break;
+	case Slave_BlockFns:
+		MODBUS_Holdings_SetBlockReadingFn(slave, readRegs);
+		MODBUS_Inputs_SetBlockWritingFn(slave, writeRegs);
+		MODBUS_Coils_SetBlockWritingFn(slave, writeCoils);
+		break;
+	default:
+		MODBUS_Holdings_SetReadingFn(slave, readReg);
+		MODBUS_Inputs_SetWritingFn(slave, writeReg);
+		MODBUS_Coils_SetWritingFn(slave, writeCoil);
+		break;
+	}
+
+	return slave;
+}
+
+// Andata e ritorno di un comando: ritorna l'esito visto dal Master
+static eMODBUS_Excpt RoundTrip(MODBUS_t *slave, MODBUS_t *master, sMODBUS_Commmand *cmd) {
+	uint8_t request[MODBUS_ADU_MAX_SIZE];
+	uint8_t response[MODBUS_ADU_MAX_SIZE];
+
+	cmd->slaveID = SLAVE_ID;
+	uint16_t requestLength = MODBUS_BuildRequest(cmd, request);
+	uint16_t responseLength = MODBUS_ProcessRequest(slave, request, requestLength, response);
+	if (responseLength == 0)
+		return Exception_InvalidFrame;
+
+	return MODBUS_ProcessResponse(master, cmd, response, responseLength);
+}
+
+static void testWrites(eSlaveKind kind) {
+	uint8_t address = SLAVE_ID;
+	MODBUS_t *slave = NewSlave(kind, &address);
+	MODBUS_t *master = MODBUS_NewHandle(NULL);
+	uint16_t values[10];
+	uint8_t bits[2] = { 0xA5, 0x03 };
+
+	memset(regs, 0, sizeof(regs));
+	memset(coils, 0, sizeof(coils));
+	memset(remoteRegs, 0, sizeof(remoteRegs));
+	MODBUS_SetMode(master, MODBUS_Mode_Master);
+	MODBUS_Holdings_SetBlockRemoteFn(master, remoteBlock);
+
+	// FC5
+	sMODBUS_Commmand fc5 = { .functionCode = FC_WriteSingleCoil, .regAddress = 9, .length = 1,
+			.u16Value = 1 };
+	CHECK(RoundTrip(slave, master, &fc5) == Exception_NoException);
+	CHECK(coils[1] == 0x02);
+
+	// FC6
+	sMODBUS_Commmand fc6 = { .functionCode = FC_WriteSingleRegister, .regAddress = 3,
+			.length = 1, .u16Value = 0x1234 };
+	CHECK(RoundTrip(slave, master, &fc6) == Exception_NoException);
+	CHECK(regs[3] == 0x1234);
+
+	// FC15: 10 bit a partire da 20, non allineati al byte
+	sMODBUS_Commmand fc15 = { .functionCode = FC_WriteMultipleCoils, .regAddress = 20,
+			.length = 10, .pvData = bits };
+	CHECK(RoundTrip(slave, master, &fc15) == Exception_NoException);
+	CHECK(coils[2] == 0x50 && coils[3] == 0x3A && coils[4] == 0x00);
+
+	// FC16
+	for (uint16_t i = 0; i < 10; i++)
+		values[i] = 0x0101 * (i + 1);
+	sMODBUS_Commmand fc16 = { .functionCode = FC_WriteMultipleRegisters, .regAddress = 40,
+			.length = 10, .pvData = values };
+	CHECK(RoundTrip(slave, master, &fc16) == Exception_NoException);
+	CHECK(regs[40] == 0x0101 && regs[49] == 0x0A0A);
+
+	// FC22: la parte letta arriva dagli holdings, quella scritta va negli inputs
+	sMODBUS_Commmand fc22 = { .functionCode = FC_MaskWriteRegister, .regAddress = 3, .length = 1,
+			.u16Value = 0xFF00, .u16OrMask = 0x00F0 };
+	CHECK(RoundTrip(slave, master, &fc22) == Exception_NoException);
+	CHECK(regs[3] == 0x12F0);
+
+	// FC23: la scrittura avviene prima della lettura, che la deve vedere
+	values[0] = 0xBEEF;
+	values[1] = 0xCAFE;
+	sMODBUS_Commmand fc23 = { .functionCode = FC_ReadWriteMultipleRegisters, .regAddress = 2,
+			.length = 4, .pvData = values, .u16WriteAddress = 4, .u16WriteLength = 2 };
+	CHECK(RoundTrip(slave, master, &fc23) == Exception_NoException);
+	CHECK(regs[4] == 0xBEEF && regs[5] == 0xCAFE);
+	CHECK(remoteRegs[2] == 0 && remoteRegs[3] == 0x12F0);
+	CHECK(remoteRegs[4] == 0xBEEF && remoteRegs[5] == 0xCAFE);
+
+	// Fuori tabella: l'eccezione dello Slave arriva al Master
+	if (kind != Slave_Banks) {
+		fc6.regAddress = REGS_SIZE;
+		CHECK(RoundTrip(slave, master, &fc6) == Exception_IllegalAddr);
+	}
+
+	MODBUS_DeleteHandle(slave);
+	MODBUS_DeleteHandle(master);
+}
+
+int main(void) {
+	for (eSlaveKind kind = 0; kind < SLAVE_KINDS; kind++)
+		testWrites(kind);
+
+	return TEST_END("test_process_request");
+}
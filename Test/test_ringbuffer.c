@@ -0,0 +1,91 @@
+/*
+ * test_ringbuffer.c
+ *
+ *  Created on: 16 ott 2026
+ *      Author: fabizani
+ *
+ *  Ring buffer: scritture e letture di ogni lunghezza, in modo che le copie passino dalla fine
+ *  del buffer e gli indici a 16 bit facciano il giro completo più volte.
+ */
+
+#include <stdint.h>
+#include "RingBuffer/ringbuffer.h"
+#include "test.h"
+
+#define RING_SIZE		16
+#define TOTAL_BYTES		200000UL	///< Oltre 65536: gli indici free-running ripartono da 0
+
+// Ogni byte è il suo numero d'ordine: un dato fuori posto si vede subito
+static uint8_t Sequence(uint32_t n) {
+	return (n * 7 + (n >> 8)) & 0xFF;
+}
+
+// Blocchi di lunghezza variabile con RingAddN e RingGetNBytes
+static void testBulkWrap(void) {
+	hRingBuffer ring = RingNew(RING_SIZE);
+	uint8_t data[RING_SIZE + 4];
+	uint32_t written = 0, read = 0;
+
+	for (uint32_t step = 0; read < TOTAL_BYTES; step++) {
+		uint16_t count = step % (RING_SIZE + 3) + 1;
+		uint16_t free = RING_SIZE - RingCountBytes(ring);
+		uint16_t overflows = RingGetOverflows(ring);
+
+		for (uint16_t i = 0; i < count; i++)
+			data[i] = Sequence(written + i);
+
+		// A buffer pieno entra solo quello che ci sta, il resto è contato come perso
+		uint16_t added = RingAddN(ring, data, count);
+		CHECK(added == ((count < free) ? count : free));
+		CHECK((uint16_t) (RingGetOverflows(ring) - overflows) == count - added);
+		written += added;
+
+		uint16_t got = RingGetNBytes(ring, data, (step * 5) % (RING_SIZE + 2));
+		for (uint16_t i = 0; i < got; i++)
+			CHECK(data[i] == Sequence(read + i));
+		read += got;
+
+		CHECK(RingCountBytes(ring) == written - read);
+	}
+
+	RingDelete(ring);
+}
+
+// Produttore a singoli byte, consumatore con RingPeekSpan/RingSkip, senza copie
+static void testPeekWrap(void) {
+	hRingBuffer ring = RingNew(RING_SIZE);
+	uint32_t written = 0, read = 0;
+
+	for (uint32_t step = 0; read < TOTAL_BYTES; step++) {
+		for (uint16_t i = step % 5; i > 0 && RingAdd(ring, Sequence(written)); i--)
+			written++;
+
+		// Lo span si ferma alla fine del buffer: il resto arriva con la chiamata successiva
+		const uint8_t *span;
+		uint16_t length = RingPeekSpan(ring, &span);
+		CHECK(length <= RING_SIZE);
+		CHECK(length <= written - read);
+
+		uint16_t take = (step % 3 == 0) ? length : length / 2;
+		for (uint16_t i = 0; i < take; i++)
+			CHECK(span[i] == Sequence(read + i));
+		CHECK(RingSkip(ring, take) == take);
+		read += take;
+	}
+
+	// Pieno: RingAdd rifiuta il byte, RingClear svuota tutto
+	while (RingAdd(ring, 0))
+		;
+	CHECK(RingCountBytes(ring) == RING_SIZE);
+	RingClear(ring);
+	CHECK(RingCountBytes(ring) == 0);
+
+	RingDelete(ring);
+}
+
+int main(void) {
+	testBulkWrap();
+	testPeekWrap();
+
+	return TEST_END("test_ringbuffer");
+}
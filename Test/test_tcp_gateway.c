@@ -0,0 +1,206 @@
+/*
+ * test_tcp_gateway.c
+ *
+ *  Created on: 16 ott 2026
+ *      Author: fabizani
+ *
+ *  Gateway TCP -> RTU nello stesso processo: la linea è un Master sul lato master di uno
+ *  pseudo-terminale, lo slave RTU ne apre l'altro capo; i client TCP sono socket grezzi su
+ *  127.0.0.1, per vedere le risposte byte per byte. Instradamento per Unit ID, eccezioni 10, 11
+ *  e 6, letture identiche servite da una sola transazione sulla linea.
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include "Core/modbus_core.h"
+#include "Port/modbus_port_posix.h"
+#include "TCP/modbus_tcp.h"
+#include "TCP/modbus_tcp_gateway.h"
+#include "test.h"
+
+#define SLAVE_ID		1
+#define SILENT_ID		2		///< Instradato sulla linea, ma nessuno slave risponde
+#define UNROUTED_ID		5		///< Nessuna linea
+#define REGS_SIZE		64
+#define QUEUE_SIZE		2
+#define BAUDRATE		115200
+#define WAIT_ms			2000	///< Attesa massima di ogni risposta, poi il test fallisce
+
+static uint16_t regs[REGS_SIZE];
+static uint16_t slaveReads;
+
+static MODBUS_t *master;
+static MODBUS_t *slave;
+static hMODBUS_TcpGateway gateway;
+
+// Letture dello slave RTU: contate per verificare quante transazioni passano sulla linea
+static eMODBUS_Excpt readRegs(const uint16_t address, const uint16_t count, uint16_t *values) {
+	if (address + count > REGS_SIZE)
+		return Exception_IllegalAddr;
+	memcpy(values, &regs[address], count * sizeof(uint16_t));
+	slaveReads++;
+	return Exception_NoException;
+}
+
+static long NowMs(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Un giro di linea, slave RTU e gateway
+static void Step(void) {
+	CHECK(MODBUS_PortPosix_Poll(master, 0) >= 0);
+	MODBUS_ExecuteTask(master);
+	CHECK(MODBUS_PortPosix_Poll(slave, 0) >= 0);
+	MODBUS_ExecuteTask(slave);
+	CHECK(MODBUS_TcpGateway_Poll(gateway, 1) >= 0);
+}
+
+static int Connect(uint16_t port) {
+	struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(port) };
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	CHECK(fd >= 0 && connect(fd, (struct sockaddr*) &addr, sizeof(addr)) == 0);
+	return fd;
+}
+
+// Lettura FC3 di count registri da address, con header MBAP
+static void SendRead(int fd, uint16_t transaction, uint8_t unit, uint16_t address, uint16_t count) {
+	uint8_t adu[MBAP_HEADER_SIZE + 5] = { transaction >> 8, transaction & 0xFF, 0, 0, 0, 6, unit,
+			FC_ReadHoldingRegisters, address >> 8, address & 0xFF, count >> 8, count & 0xFF };
+
+	CHECK(send(fd, adu, sizeof(adu), 0) == sizeof(adu));
+}
+
+// Fa girare tutto finché non arriva una ADU intera; ritorna la sua lunghezza, 0 se non arriva
+static uint16_t ReceiveAdu(int fd, uint8_t *adu) {
+	long deadline = NowMs() + WAIT_ms;
+	uint16_t need = MBAP_PREFIX_SIZE;
+	uint16_t got = 0;
+
+	while (got < need && NowMs() < deadline) {
+		Step();
+		ssize_t n = recv(fd, adu + got, need - got, MSG_DONTWAIT);
+		if (n > 0)
+			got += n;
+		if (got == MBAP_PREFIX_SIZE && need == MBAP_PREFIX_SIZE)
+			need += (adu[MBAP_LENGTH] << 8) | adu[MBAP_LENGTH + 1];
+	}
+
+	CHECK(got == need);
+	return (got == need) ? got : 0;
+}
+
+// Risposta di lettura con il Transaction ID e i registri attesi
+static void CheckRead(const uint8_t *adu, uint16_t length, uint16_t transaction, uint16_t address,
+		uint16_t count) {
+	CHECK(length == MBAP_HEADER_SIZE + 2 + 2 * count);
+	CHECK(((adu[MBAP_TRANSACTION] << 8) | adu[MBAP_TRANSACTION + 1]) == transaction);
+	CHECK(adu[MBAP_UNIT] == SLAVE_ID && adu[MBAP_HEADER_SIZE] == FC_ReadHoldingRegisters);
+	for (uint16_t i = 0; i < count && length == MBAP_HEADER_SIZE + 2 + 2 * count; i++)
+		CHECK(((adu[MBAP_HEADER_SIZE + 2 + 2 * i] << 8) | adu[MBAP_HEADER_SIZE + 3 + 2 * i])
+				== regs[address + i]);
+}
+
+static void CheckException(const uint8_t *adu, uint16_t length, uint16_t transaction,
+		eMODBUS_Excpt excpt) {
+	CHECK(length == MBAP_HEADER_SIZE + 2);
+	CHECK(((adu[MBAP_TRANSACTION] << 8) | adu[MBAP_TRANSACTION + 1]) == transaction);
+	CHECK(adu[MBAP_HEADER_SIZE] == (0x80 | FC_ReadHoldingRegisters));
+	CHECK(adu[MBAP_HEADER_SIZE + 1] == excpt);
+}
+
+int main(void) {
+	static sMODBUS_PortPosix masterCtx, slaveCtx;
+	static sMODBUS_Port masterPort, slavePort;
+	uint8_t address = SLAVE_ID;
+	uint8_t adu[MODBUS_TCP_ADU_MAX_SIZE];
+	uint16_t length;
+
+	for (uint16_t i = 0; i < REGS_SIZE; i++)
+		regs[i] = i * 257 + 1;
+
+	// Linea: il Master crea il pty, lo slave RTU ne apre il lato slave
+	MODBUS_PortPosix_Init(&masterPort, &masterCtx, NULL, BAUDRATE, 'N');
+	master = MODBUS_NewHandle(&masterPort);
+	CHECK(master != NULL);
+	if (master == NULL)
+		return TEST_END("test_tcp_gateway");
+	MODBUS_SetMode(master, MODBUS_Mode_Master);
+
+	MODBUS_PortPosix_Init(&slavePort, &slaveCtx, MODBUS_PortPosix_GetPtyName(&masterCtx), BAUDRATE,
+			'N');
+	slave = MODBUS_NewHandle(&slavePort);
+	CHECK(slave != NULL);
+	if (slave == NULL)
+		return TEST_END("test_tcp_gateway");
+	MODBUS_SetAddress(slave, &address);
+	MODBUS_Holdings_SetBlockReadingFn(slave, readRegs);
+
+	gateway = MODBUS_TcpGateway_New(0, 4);
+	CHECK(gateway != NULL);
+	if (gateway == NULL)
+		return TEST_END("test_tcp_gateway");
+	uint8_t line = MODBUS_TcpGateway_AddLine(gateway, master, QUEUE_SIZE);
+	CHECK(line == 0);
+	MODBUS_TcpGateway_Route(gateway, SLAVE_ID, SILENT_ID, line);
+
+	uint16_t port = MODBUS_TcpServer_GetPort(MODBUS_TcpGateway_GetServer(gateway));
+	int clientA = Connect(port);
+	int clientB = Connect(port);
+
+	// Instradamento: la risposta dello slave torna con il Transaction ID del client
+	SendRead(clientA, 0x1234, SLAVE_ID, 8, 10);
+	length = ReceiveAdu(clientA, adu);
+	CheckRead(adu, length, 0x1234, 8, 10);
+
+	// Unit ID senza linea: eccezione 10 dal gateway, nulla sulla linea
+	slaveReads = 0;
+	SendRead(clientA, 2, UNROUTED_ID, 0, 1);
+	length = ReceiveAdu(clientA, adu);
+	CheckException(adu, length, 2, Exception_GatewayPath);
+
+	// Slave che non risponde: eccezione 11 allo scadere del timeout della linea
+	SendRead(clientA, 3, SILENT_ID, 0, 1);
+	length = ReceiveAdu(clientA, adu);
+	CheckException(adu, length, 3, Exception_GatewayTarget);
+	CHECK(slaveReads == 0);
+
+	// Coda piena: la prima parte, la seconda attende, la terza riceve subito l'eccezione 6
+	SendRead(clientA, 10, SLAVE_ID, 0, 4);
+	SendRead(clientA, 11, SLAVE_ID, 10, 4);
+	SendRead(clientA, 12, SLAVE_ID, 20, 4);
+	length = ReceiveAdu(clientA, adu);
+	CheckException(adu, length, 12, Exception_Busy);
+	length = ReceiveAdu(clientA, adu);
+	CheckRead(adu, length, 10, 0, 4);
+	length = ReceiveAdu(clientA, adu);
+	CheckRead(adu, length, 11, 10, 4);
+	CHECK(slaveReads == 2);
+
+	// Stessa lettura da due client: una sola transazione, la risposta arriva ad entrambi
+	slaveReads = 0;
+	SendRead(clientA, 20, SLAVE_ID, 30, 8);
+	Step();
+	SendRead(clientB, 21, SLAVE_ID, 30, 8);
+	length = ReceiveAdu(clientA, adu);
+	CheckRead(adu, length, 20, 30, 8);
+	length = ReceiveAdu(clientB, adu);
+	CheckRead(adu, length, 21, 30, 8);
+	CHECK(slaveReads == 1);
+
+	close(clientA);
+	close(clientB);
+	MODBUS_TcpGateway_Delete(gateway);
+	MODBUS_DeleteHandle(slave);
+	MODBUS_DeleteHandle(master);
+
+	return TEST_END("test_tcp_gateway");
+}
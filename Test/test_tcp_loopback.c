@@ -0,0 +1,126 @@
+/*
+ * test_tcp_loopback.c
+ *
+ *  Created on: 16 ott 2026
+ *      Author: fabizani
+ *
+ *  Server e client Modbus TCP nello stesso processo, collegati su 127.0.0.1 (porta scelta dal
+ *  sistema): letture in pipeline, scritture e deduplicazione delle letture già in volo.
+ */
+
+#include <string.h>
+#include <time.h>
+#include "Core/modbus_core.h"
+#include "TCP/modbus_tcp_client.h"
+#include "TCP/modbus_tcp_server.h"
+#include "test.h"
+
+#define SLAVE_ID		1
+#define REGS_SIZE		128
+#define WINDOW			4
+#define WAIT_ms			2000	///< Attesa massima di ogni scambio, poi il test fallisce
+#define SETTLE_ms		100		///< Attesa di risposte che non devono arrivare
+
+static uint16_t regs[REGS_SIZE];
+static uint16_t remoteRegs[REGS_SIZE];
+static uint16_t completed;
+
+static void remoteBlock(const uint8_t id, const uint16_t address, const uint16_t count,
+		const uint16_t *values) {
+	(void) id;
+	memcpy(&remoteRegs[address], values, count * sizeof(uint16_t));
+}
+
+static void remoteCompleted(void) {
+	completed++;
+}
+
+static long NowMs(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Fa girare server e client finché non sono completati expected comandi o passano waitMs
+static void Run(hMODBUS_TcpServer server, hMODBUS_TcpClient client, uint16_t expected,
+		long waitMs) {
+	long deadline = NowMs() + waitMs;
+
+	while (completed < expected && NowMs() < deadline) {
+		CHECK(MODBUS_TcpServer_Poll(server, 0) >= 0);
+		CHECK(MODBUS_TcpClient_Poll(client, 1) >= 0);
+	}
+}
+
+int main(void) {
+	uint8_t address = SLAVE_ID;
+	uint16_t values[10];
+
+	for (uint16_t i = 0; i < REGS_SIZE; i++)
+		regs[i] = i * 257 + 1;
+
+	MODBUS_t *local = MODBUS_NewHandle(NULL);
+	MODBUS_SetAddress(local, &address);
+	MODBUS_Holdings_SetBank(local, regs, 0, REGS_SIZE);
+	MODBUS_Inputs_SetBank(local, regs, 0, REGS_SIZE);
+	hMODBUS_TcpServer server = MODBUS_TcpServer_New(local, 0, 4);
+	CHECK(server != NULL);
+	if (server == NULL)
+		return TEST_END("test_tcp_loopback");
+
+	MODBUS_t *remote = MODBUS_NewHandle(NULL);
+	MODBUS_SetMode(remote, MODBUS_Mode_Master);
+	MODBUS_Holdings_SetBlockRemoteFn(remote, remoteBlock);
+	MODBUS_SetRemoteCmptCallback(remote, remoteCompleted);
+	hMODBUS_TcpClient client = MODBUS_TcpClient_New(remote, "127.0.0.1",
+			MODBUS_TcpServer_GetPort(server), WINDOW);
+	CHECK(client != NULL);
+	if (client == NULL)
+		return TEST_END("test_tcp_loopback");
+
+	// Più letture della finestra: partono a gruppi di WINDOW, senza attendere le risposte
+	for (uint16_t i = 0; i < 16; i++) {
+		sMODBUS_Commmand read = { .functionCode = FC_ReadHoldingRegisters, .slaveID = SLAVE_ID,
+				.regAddress = i * 8, .length = 8 };
+		CHECK(MODBUS_QueueCommand(remote, &read));
+	}
+	Run(server, client, 16, WAIT_ms);
+	CHECK(completed == 16);
+	CHECK(memcmp(remoteRegs, regs, sizeof(regs)) == 0);
+	CHECK(MODBUS_TcpClient_GetOutstanding(client) == 0);
+	CHECK(MODBUS_TcpServer_GetClientCount(server) == 1);
+
+	// FC16, poi rilettura
+	for (uint16_t i = 0; i < 10; i++)
+		values[i] = 0xA000 + i;
+	sMODBUS_Commmand write = { .functionCode = FC_WriteMultipleRegisters, .slaveID = SLAVE_ID,
+			.regAddress = 100, .length = 10, .pvData = values };
+	sMODBUS_Commmand read = { .functionCode = FC_ReadHoldingRegisters, .slaveID = SLAVE_ID,
+			.regAddress = 100, .length = 10 };
+	completed = 0;
+	CHECK(MODBUS_QueueCommand(remote, &write));
+	Run(server, client, 1, WAIT_ms);
+	CHECK(MODBUS_QueueCommand(remote, &read));
+	Run(server, client, 2, WAIT_ms);
+	CHECK(regs[100] == 0xA000 && regs[109] == 0xA009);
+	CHECK(remoteRegs[100] == 0xA000 && remoteRegs[109] == 0xA009);
+
+	// La stessa lettura, accodata mentre la prima è in volo, non viene spedita di nuovo
+	completed = 0;
+	CHECK(MODBUS_QueueCommand(remote, &read));
+	CHECK(MODBUS_TcpClient_Poll(client, 0) >= 0);
+	CHECK(MODBUS_TcpClient_GetOutstanding(client) == 1);
+	CHECK(MODBUS_QueueCommand(remote, &read));
+	Run(server, client, 1, WAIT_ms);
+	Run(server, client, 2, SETTLE_ms);
+	CHECK(completed == 1);
+	CHECK(MODBUS_TcpClient_GetOutstanding(client) == 0);
+
+	MODBUS_TcpClient_Delete(client);
+	MODBUS_TcpServer_Delete(server);
+	MODBUS_DeleteHandle(remote);
+	MODBUS_DeleteHandle(local);
+
+	return TEST_END("test_tcp_loopback");
+}
@@ -17,6 +17,7 @@
 
 
 #include <Core/modbus_core.h>
+#include <Core/modbus_map.h>
 
 // Variabile MODBUS e relative funzioni di callback
 extern MODBUS_t* MODBUS;
@@ -24,18 +25,23 @@ extern MODBUS_t* MODBUS;
 void MODBUS_Init();
 
 
-sMODBUS_ReadResult MODBUS_readCoils(const uint16_t address);
-eMODBUS_Excpt MODBUS_writeCoils(const uint16_t address, const uint16_t data);
+eMODBUS_Excpt MODBUS_readCoilsBlock(const uint16_t address, const uint16_t count, uint8_t *bits);
+eMODBUS_Excpt MODBUS_writeCoilsBlock(const uint16_t address, const uint16_t count,
+		const uint8_t *bits);
 void MODBUS_remoteCoils(const uint8_t ID, const uint16_t address, const uint16_t data);
 
-sMODBUS_ReadResult MODBUS_readDiscretes(const uint16_t address);
+eMODBUS_Excpt MODBUS_readDiscretesBlock(const uint16_t address, const uint16_t count,
+		uint8_t *bits);
 void MODBUS_remoteDiscretes(const uint8_t ID, const uint16_t address, const uint16_t data);
 
-sMODBUS_ReadResult MODBUS_readHoldings(const uint16_t address);
+eMODBUS_Excpt MODBUS_readHoldingsBlock(const uint16_t address, const uint16_t count,
+		uint16_t *regs);
 void MODBUS_remoteHoldings(const uint8_t ID, const uint16_t address, const uint16_t data);
 
-sMODBUS_ReadResult MODBUS_readInputs(const uint16_t address);
-eMODBUS_Excpt MODBUS_writeInputs(const uint16_t address, const uint16_t data);
+eMODBUS_Excpt MODBUS_readInputsBlock(const uint16_t address, const uint16_t count,
+		uint16_t *regs);
+eMODBUS_Excpt MODBUS_writeInputsBlock(const uint16_t address, const uint16_t count,
+		const uint16_t *regs);
 void MODBUS_remoteInputs(const uint8_t ID, const uint16_t address, const uint16_t data);
 
 //************************ CALLBACKS ************************
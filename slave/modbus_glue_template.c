@@ -25,101 +25,64 @@
 
 hMODBUS MODBUS;
 
+/* Tabelle di dispatch generate dalla mappa: ogni richiesta del Master viene risolta con una ricerca
+ * (diretta o binaria) sugli intervalli, senza switch scritti a mano.
+ * Le variabili indicate nella mappa devono essere visibili da qui.
+ * Ricordarsi di chiamare MODBUS_Map_Init su ogni tabella durante MODBUS_Init().
+ */
+MODBUS_MAP_TABLE(coilsMap, MAP_COILS);
+MODBUS_MAP_TABLE(discretesMap, MAP_DISCRETES);
+MODBUS_MAP_TABLE(holdingsMap, MAP_HOLDINGS);
+MODBUS_MAP_TABLE(inputsMap, MAP_INPUTS);
+
 
 /**************************************************************************************************
  * 								FUNZIONI LETTURA/SCRITTURA COILS
  **************************************************************************************************/
-sMODBUS_ReadResult MODBUS_readCoils(uint16_t address) {
-	sMODBUS_ReadResult result = { .data = 0, .error = Exception_NoException };
-
-	switch (address) {
-
-    /* Inserire i case provenienti dalla modbus_map.h */
-
-	default:
-		result.error = Exception_IllegalAddr;
-		break;
-	}
-
-	return result;
+eMODBUS_Excpt MODBUS_readCoilsBlock(const uint16_t address, const uint16_t count, uint8_t *bits) {
+	return MODBUS_Map_ReadBits(&coilsMap, address, count, bits);
 }
 
-eMODBUS_Excpt MODBUS_writeCoils(uint16_t address, uint16_t data) {
-	switch (address) {
+eMODBUS_Excpt MODBUS_writeCoilsBlock(const uint16_t address, const uint16_t count,
+		const uint8_t *bits) {
+	eMODBUS_Excpt error = MODBUS_Map_WriteBits(&coilsMap, address, count, bits);
 
-    /* Inserire i case provenienti dalla modbus_map.h */
+	/* Inserire eventuali azioni legate alla scrittura delle coils */
 
-	default:
-		result.error = Exception_IllegalAddr;
-		return result;
-
-	}
-
-	return Exception_NoException;
+	return error;
 }
 
 /**************************************************************************************************
  * 									FUNZIONI LETTURA DISCRETES
  **************************************************************************************************/
-sMODBUS_ReadResult MODBUS_readDiscretes(uint16_t address) {
-	sMODBUS_ReadResult result = { .data = 0, .error = Exception_NoException };
-
-	switch (address) {
-
-    /* Inserire i case provenienti dalla modbus_map.h */
-
-	default:
-		result.error = Exception_IllegalAddr;
-		return result;
-	}
-
-	return result;
+eMODBUS_Excpt MODBUS_readDiscretesBlock(const uint16_t address, const uint16_t count,
+		uint8_t *bits) {
+	return MODBUS_Map_ReadBits(&discretesMap, address, count, bits);
 }
 
 /**************************************************************************************************
  * 							FUNZIONI LETTURA/SCRITTURA HOLDINGS REGISTERS
  **************************************************************************************************/
-sMODBUS_ReadResult MODBUS_readHoldings(uint16_t address) {
-	sMODBUS_ReadResult result = { .data = 0, .error = Exception_NoException };
-
-	switch (address) {
-
-    /* Inserire i case provenienti dalla modbus_map.h */
-
-	default:
-		result.error = Exception_IllegalAddr;
-		break;
-	}
-
-	return result;
+eMODBUS_Excpt MODBUS_readHoldingsBlock(const uint16_t address, const uint16_t count,
+		uint16_t *regs) {
+	return MODBUS_Map_ReadRegs(&holdingsMap, address, count, regs);
 }
 
 /**************************************************************************************************
  * 							FUNZIONI LETTURA/SCRITTURA INPUT REGISTERS
  **************************************************************************************************/
-sMODBUS_ReadResult MODBUS_readInputs(uint16_t address) {
-	sMODBUS_ReadResult result = { .data = 0, .error = Exception_NoException };
-
-    switch (address) {
-
-    /* Inserire i case provenienti dalla modbus_map.h */
-
-	default:
-		result.error = Exception_IllegalAddr;
-		break;
-	}
-
-	return result;
+eMODBUS_Excpt MODBUS_readInputsBlock(const uint16_t address, const uint16_t count,
+		uint16_t *regs) {
+	return MODBUS_Map_ReadRegs(&inputsMap, address, count, regs);
 }
 
-eMODBUS_Excpt MODBUS_writeInputs(uint16_t address, uint16_t data) {
-	switch (address) {
-
-    /* Inserire i case provenienti dalla modbus_map.h */
+eMODBUS_Excpt MODBUS_writeInputsBlock(const uint16_t address, const uint16_t count,
+		const uint16_t *regs) {
+	eMODBUS_Excpt error = MODBUS_Map_WriteRegs(&inputsMap, address, count, regs);
 
-	}
+	/* Inserire eventuali azioni legate alla scrittura dei registri */
 
-	return Exception_NoException;
+	return error;
 }
 
 /**************************************************************************************************